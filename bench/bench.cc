@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <unistd.h>
+
+namespace ns3 {
+namespace bench {
+
+    double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void PrintDistribution(const std::string &label, std::vector<double> &samples, const std::string &unit) {
+        if (samples.empty()) {
+            std::cout << label << ": no samples" << std::endl;
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))];
+        };
+        const double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        std::cout << std::fixed << std::setprecision(2)
+                << label << ": n=" << samples.size()
+                << " mean=" << mean << unit
+                << " p50=" << percentile(0.5) << unit
+                << " p99=" << percentile(0.99) << unit
+                << " max=" << samples.back() << unit << std::endl;
+    }
+
+    uint64_t GetResidentBytes(void) {
+        std::ifstream statm("/proc/self/statm");
+        uint64_t size = 0;
+        uint64_t resident = 0;
+        statm >> size >> resident;
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+} // namespace bench
+} // namespace ns3
+
+namespace {
+
+    struct Driver {
+        const char *name;
+        int (*run)(int argc, char *argv[]);
+        const char *description;
+    };
+
+    const Driver DRIVERS[] = {
+        { "transport", &ns3::bench::RunTransportBench, "ADVANCE_TIME/END round trip latency over TCP loopback, unix domain sockets and shared memory" },
+        { "run-until", &ns3::bench::RunRunUntilBench, "event loop cost per advance window, per-event loop against RunUntil" },
+        { "scheduler", &ns3::bench::RunSchedulerBench, "event schedulers replaying recorded (--trace) or synthetic event timestamps" },
+        { "node-table", &ns3::bench::RunNodeTableBench, "node id lookups, std::map and flag maps against the dense node table" },
+        { "profile", &ns3::bench::RunProfileBench, "memory and idle events per simulated second of the radio node profiles" },
+        { "wifi-channel", &ns3::bench::RunWifiChannelBench, "Wifi broadcasts among 1k to 20k vehicles, plain channel against MaxRange culling" },
+    };
+
+    void PrintUsage(const char *program) {
+        std::cout << "Usage: " << program << " <driver> [--PrintHelp] [--option=value ...]" << std::endl << "Drivers:" << std::endl;
+        for (const Driver &driver : DRIVERS) {
+            std::cout << "  " << std::left << std::setw(14) << driver.name << driver.description << std::endl;
+        }
+    }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    for (const Driver &driver : DRIVERS) {
+        if (strcmp(argv[1], driver.name) == 0) {
+            // the driver sees its name as program name
+            return driver.run(argc - 1, argv + 1);
+        }
+    }
+    std::cerr << "Unknown driver " << argv[1] << std::endl;
+    PrintUsage(argv[0]);
+    return 1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef MOSAIC_BENCH_H
+#define MOSAIC_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Standalone benchmark drivers, run as "bench <driver> [--option=value ...]".
+ * None of them needs MOSAIC, the ambassador side is replaced by a stand-in where required.
+ */
+namespace ns3 {
+namespace bench {
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @brief seconds elapsed since start
+     */
+    double SecondsSince(Clock::time_point start);
+
+    /**
+     * @brief prints count, mean and percentiles of the samples in one line, the samples are sorted in place
+     *
+     * @param label name of the measurement
+     * @param samples measured values
+     * @param unit unit of the values
+     */
+    void PrintDistribution(const std::string &label, std::vector<double> &samples, const std::string &unit);
+
+    /**
+     * @brief resident set size of this process in bytes, read from /proc/self/statm
+     */
+    uint64_t GetResidentBytes(void);
+
+    /** ADVANCE_TIME/END round trips over the ClientServerChannel transports */
+    int RunTransportBench(int argc, char *argv[]);
+
+    /** event loop of an advance window, per-event loop against MosaicSimulatorImpl::RunUntil */
+    int RunRunUntilBench(int argc, char *argv[]);
+
+    /** List, Map, Heap, Calendar and MosaicCalendar scheduler on recorded or synthetic timestamps */
+    int RunSchedulerBench(int argc, char *argv[]);
+
+    /** node id lookups, std::map and flag maps against the dense node table */
+    int RunNodeTableBench(int argc, char *argv[]);
+
+    /** memory and idle event load per radio node profile */
+    int RunProfileBench(int argc, char *argv[]);
+
+    /** Wifi broadcast cost for 1k to 20k vehicles, YansWifiChannel against MosaicWifiChannel */
+    int RunWifiChannelBench(int argc, char *argv[]);
+
+} // namespace bench
+} // namespace ns3
+#endif /* MOSAIC_BENCH_H */
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Node lookups of MosaicNodeManager at large node counts: the former std::map id translations with
+ * unordered_map<uint32_t, bool> flags against the dense NodeRecord table indexed by ns-3 node id and
+ * the flat MOSAIC id vector. The node manager keeps its table private and creating ns-3 nodes would
+ * dominate the measurement, so both layouts are replicated here with the lookups of one send and
+ * one receive: MOSAIC id to ns-3 id, the activity and radio flags, and ns-3 id back to MOSAIC id.
+ */
+
+#include "bench.h"
+
+#include <iostream>
+#include <map>
+#include <random>
+#include <unordered_map>
+
+#include "ns3/command-line.h"
+
+namespace ns3 {
+namespace bench {
+
+    namespace {
+
+        const uint32_t INVALID_NODE_ID = UINT32_MAX;
+
+        /** layout before the dense node table */
+        struct MapTable {
+            std::map<uint32_t, uint32_t> mosaic2nsdrei;
+            std::map<uint32_t, uint32_t> nsdrei2mosaic;
+            std::unordered_map<uint32_t, bool> isRadioNode;
+            std::unordered_map<uint32_t, bool> isWifiRadioConfigured;
+            std::unordered_map<uint32_t, bool> isDeactivated;
+
+            void Add(uint32_t mosaicNodeId, uint32_t nodeId) {
+                mosaic2nsdrei[mosaicNodeId] = nodeId;
+                nsdrei2mosaic[nodeId] = mosaicNodeId;
+                isRadioNode[nodeId] = true;
+                isWifiRadioConfigured[nodeId] = true;
+                isDeactivated[nodeId] = false;
+            }
+
+            uint32_t Lookup(uint32_t mosaicNodeId) {
+                auto it = mosaic2nsdrei.find(mosaicNodeId);
+                if (it == mosaic2nsdrei.end()) {
+                    return INVALID_NODE_ID;
+                }
+                const uint32_t nodeId = it->second;
+                if (isDeactivated[nodeId] || !isRadioNode[nodeId] || !isWifiRadioConfigured[nodeId]) {
+                    return INVALID_NODE_ID;
+                }
+                return nsdrei2mosaic[nodeId];
+            }
+        };
+
+        /** layout of MosaicNodeManager::NodeRecord and m_mosaic2nsdrei */
+        struct DenseTable {
+            struct NodeRecord {
+                enum Flag : uint8_t {
+                    RADIO = 1 << 0,
+                    WIFI_CONFIGURED = 1 << 2,
+                    DEACTIVATED = 1 << 4,
+                };
+                uint32_t mosaicNodeId = INVALID_NODE_ID;
+                uint8_t flags = 0;
+            };
+            std::vector<NodeRecord> nodes;
+            std::vector<uint32_t> mosaic2nsdrei;
+
+            void Add(uint32_t mosaicNodeId, uint32_t nodeId) {
+                if (mosaicNodeId >= mosaic2nsdrei.size()) {
+                    mosaic2nsdrei.resize(mosaicNodeId + 1, INVALID_NODE_ID);
+                }
+                mosaic2nsdrei[mosaicNodeId] = nodeId;
+                if (nodeId >= nodes.size()) {
+                    nodes.resize(nodeId + 1);
+                }
+                nodes[nodeId].mosaicNodeId = mosaicNodeId;
+                nodes[nodeId].flags = NodeRecord::RADIO | NodeRecord::WIFI_CONFIGURED;
+            }
+
+            uint32_t Lookup(uint32_t mosaicNodeId) const {
+                if (mosaicNodeId >= mosaic2nsdrei.size() || mosaic2nsdrei[mosaicNodeId] == INVALID_NODE_ID) {
+                    return INVALID_NODE_ID;
+                }
+                const NodeRecord &record = nodes[mosaic2nsdrei[mosaicNodeId]];
+                const uint8_t required = NodeRecord::RADIO | NodeRecord::WIFI_CONFIGURED;
+                if ((record.flags & (required | NodeRecord::DEACTIVATED)) != required) {
+                    return INVALID_NODE_ID;
+                }
+                return record.mosaicNodeId;
+            }
+        };
+
+        template <typename Table>
+        double MeasureLookups(Table &table, const std::vector<uint32_t> &ids, uint64_t &checksum) {
+            const Clock::time_point start = Clock::now();
+            for (uint32_t id : ids) {
+                checksum += table.Lookup(id);
+            }
+            return SecondsSince(start);
+        }
+
+    } // namespace
+
+    int RunNodeTableBench(int argc, char *argv[]) {
+        uint32_t nodes = 50000;
+        uint32_t lookups = 10000000;
+        uint32_t seed = 1;
+
+        CommandLine cmd;
+        cmd.Usage("Node id lookups, std::map and unordered_map flags against the dense node table.");
+        cmd.AddValue("nodes", "number of nodes", nodes);
+        cmd.AddValue("lookups", "number of lookups of random MOSAIC ids", lookups);
+        cmd.AddValue("seed", "seed of the random ids", seed);
+        cmd.Parse(argc, argv);
+
+        // ns-3 ids are shifted against the MOSAIC ids as the eNBs and wired nodes are created first
+        MapTable mapTable;
+        DenseTable denseTable;
+        for (uint32_t i = 0; i < nodes; i++) {
+            mapTable.Add(i, i + 10);
+            denseTable.Add(i, i + 10);
+        }
+        std::mt19937 random(seed);
+        std::uniform_int_distribution<uint32_t> id(0, nodes - 1);
+        std::vector<uint32_t> ids(lookups);
+        for (uint32_t &i : ids) {
+            i = id(random);
+        }
+
+        uint64_t mapChecksum = 0;
+        uint64_t denseChecksum = 0;
+        const double mapSeconds = MeasureLookups(mapTable, ids, mapChecksum);
+        const double denseSeconds = MeasureLookups(denseTable, ids, denseChecksum);
+        if (mapChecksum != denseChecksum) {
+            std::cerr << "Lookups of both tables differ" << std::endl;
+            return 1;
+        }
+        std::cout << "map: nodes=" << nodes << " per lookup=" << mapSeconds * 1e9 / lookups << "ns" << std::endl;
+        std::cout << "dense: nodes=" << nodes << " per lookup=" << denseSeconds * 1e9 / lookups << "ns" << std::endl;
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Cost of the radio node profiles: every profile creates the same number of radio nodes through
+ * MosaicNodeManager, configures the radios the profile installs, and runs the simulation without any
+ * traffic. Reported are the resident memory per node after setup and the events per simulated second,
+ * i.e. the idle load of the devices such as the 1 ms LTE subframes. Each profile runs in a forked child
+ * process, as the ns-3 globals, the simulator and the node list cannot be reset in between.
+ * No bridge is attached, receptions would only be counted by the node manager; without traffic there are none.
+ */
+
+#include "bench.h"
+
+#include <iostream>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/boolean.h"
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/global-value.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include "mosaic-node-manager.h"
+#include "mosaic-simulator-impl.h"
+
+namespace ns3 {
+namespace bench {
+
+    namespace {
+
+        bool ParseProfile(const std::string &name, MosaicNodeManager::RadioNodeProfile &profile) {
+            if (name == "Dual") {
+                profile = MosaicNodeManager::RADIO_PROFILE_DUAL;
+            } else if (name == "WifiOnly") {
+                profile = MosaicNodeManager::RADIO_PROFILE_WIFI_ONLY;
+            } else if (name == "CellOnly") {
+                profile = MosaicNodeManager::RADIO_PROFILE_CELL_ONLY;
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        void MeasureProfile(const std::string &name, MosaicNodeManager::RadioNodeProfile profile, uint32_t nodes, uint32_t enbs, Time duration) {
+            GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::MosaicSimulatorImpl"));
+            Config::SetDefault("ns3::MosaicNodeManager::LazyLteSetup", BooleanValue(true));
+            Config::SetDefault("ns3::MosaicNodeManager::numExtraRadioNodes", UintegerValue(0));
+            // with the default SRS periodicity of 40 an eNB admits less than 40 UEs
+            Config::SetDefault("ns3::LteEnbRrc::SrsPeriodicity", UintegerValue(320));
+            Ptr<MosaicSimulatorImpl> sim = DynamicCast<MosaicSimulatorImpl>(Simulator::GetImplementation());
+
+            const uint64_t residentBefore = GetResidentBytes();
+            const Clock::time_point setupStart = Clock::now();
+            Ptr<MosaicNodeManager> nodeManager = CreateObject<MosaicNodeManager>();
+            nodeManager->Configure(nullptr);
+            const bool usesCell = profile != MosaicNodeManager::RADIO_PROFILE_WIFI_ONLY;
+            const bool usesWifi = profile != MosaicNodeManager::RADIO_PROFILE_CELL_ONLY;
+            const uint32_t columns = 100;
+            for (uint32_t i = 0; usesCell && i < enbs; i++) {
+                nodeManager->CreateNodeB(Vector(1000.0 * (i % 5), 1000.0 * (i / 5), 30));
+            }
+            for (uint32_t i = 0; i < nodes; i++) {
+                nodeManager->CreateRadioNode(i, Vector(10.0 * (i % columns), 10.0 * (i / columns), 0), profile);
+            }
+            nodeManager->OnStart();
+            for (uint32_t i = 0; i < nodes; i++) {
+                const Ipv4Address ip(Ipv4Address("10.1.0.0").Get() + i + 1);
+                if (usesWifi) {
+                    nodeManager->ConfigureWifiRadio(i, -1, ip);
+                }
+                if (usesCell) {
+                    nodeManager->ConfigureCellRadio(i, ip);
+                }
+            }
+            const double setupSeconds = SecondsSince(setupStart);
+            const uint64_t residentAfter = GetResidentBytes();
+
+            const Clock::time_point runStart = Clock::now();
+            const uint64_t events = sim->RunUntil(duration.GetTimeStep(), std::function<bool()>());
+            const double runSeconds = SecondsSince(runStart);
+
+            std::cout << name << ": nodes=" << nodes
+                    << " setup=" << setupSeconds << "s"
+                    << " memory=" << (residentAfter - residentBefore) / 1024 / 1024 << "MiB"
+                    << " (" << (residentAfter - residentBefore) / nodes << " bytes per node)"
+                    << " events per simulated s=" << static_cast<uint64_t>(events / duration.GetSeconds())
+                    << " wall per simulated s=" << runSeconds / duration.GetSeconds() << "s" << std::endl;
+        }
+
+    } // namespace
+
+    int RunProfileBench(int argc, char *argv[]) {
+        uint32_t nodes = 5000;
+        uint32_t enbs = 20;
+        Time duration = Seconds(1);
+        std::string profiles = "Dual,WifiOnly,CellOnly";
+
+        CommandLine cmd;
+        cmd.Usage("Memory and idle event load of the radio node profiles.");
+        cmd.AddValue("nodes", "number of radio nodes", nodes);
+        cmd.AddValue("enbs", "number of eNBs for the profiles with LTE", enbs);
+        cmd.AddValue("duration", "simulated time", duration);
+        cmd.AddValue("profiles", "comma separated list of Dual, WifiOnly, CellOnly", profiles);
+        cmd.Parse(argc, argv);
+
+        std::stringstream list(profiles);
+        std::string name;
+        while (std::getline(list, name, ',')) {
+            MosaicNodeManager::RadioNodeProfile profile;
+            if (!ParseProfile(name, profile)) {
+                std::cerr << "Unknown profile " << name << std::endl;
+                return 1;
+            }
+            std::cout.flush();
+            const pid_t child = fork();
+            if (child == 0) {
+                MeasureProfile(name, profile, nodes, enbs, duration);
+                std::cout.flush();
+                _exit(0);
+            }
+            int status = 0;
+            if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                std::cerr << "Measurement of profile " << name << " failed" << std::endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Cost of running the events of an advance window: the per-event loop used before
+ * MosaicSimulatorImpl::RunUntil (check IsFinished() and Next(), then RunOneEvent()) against one
+ * RunUntil() call per window. The load are self-rescheduling periodic timers with spread phases,
+ * similar to the 1 ms LTE subframe events of many nodes. No bridge is attached, so scheduling does
+ * not write NEXT_EVENT frames and only the event loop is measured.
+ */
+
+#include "bench.h"
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+
+#include "ns3/command-line.h"
+#include "ns3/global-value.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+
+#include "mosaic-simulator-impl.h"
+
+namespace ns3 {
+namespace bench {
+
+    namespace {
+
+        void Tick(Time period) {
+            Simulator::Schedule(period, &Tick, period);
+        }
+
+        /**
+         * Runs the timers in windows up to the duration and returns the number of processed events.
+         */
+        uint64_t RunWindows(const std::string &loop, uint32_t timers, Time period, Time window, Time duration, double &seconds) {
+            GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::MosaicSimulatorImpl"));
+            Ptr<MosaicSimulatorImpl> sim = DynamicCast<MosaicSimulatorImpl>(Simulator::GetImplementation());
+            for (uint32_t i = 0; i < timers; i++) {
+                Simulator::Schedule(NanoSeconds(period.GetNanoSeconds() * i / timers), &Tick, period);
+            }
+
+            uint64_t events = 0;
+            const Clock::time_point start = Clock::now();
+            for (Time grant = window; grant <= duration; grant += window) {
+                if (loop == "per-event") {
+                    while (!sim->IsFinished() && grant >= sim->Next()) {
+                        sim->RunOneEvent();
+                        events++;
+                    }
+                } else if (loop == "run-until") {
+                    events += sim->RunUntil(grant.GetTimeStep(), std::function<bool()>());
+                } else {
+                    std::cerr << "Unknown loop " << loop << std::endl;
+                    exit(1);
+                }
+            }
+            seconds = SecondsSince(start);
+            Simulator::Destroy();
+            return events;
+        }
+
+    } // namespace
+
+    int RunRunUntilBench(int argc, char *argv[]) {
+        uint32_t timers = 1000;
+        Time period = MilliSeconds(1);
+        Time window = MilliSeconds(100);
+        Time duration = Seconds(10);
+        std::string loops = "per-event,run-until";
+        std::string scheduler = "ns3::ListScheduler";
+
+        CommandLine cmd;
+        cmd.Usage("Event loop cost per advance window, per-event loop against MosaicSimulatorImpl::RunUntil.");
+        cmd.AddValue("timers", "number of periodic timers", timers);
+        cmd.AddValue("period", "period of each timer", period);
+        cmd.AddValue("window", "length of one advance window", window);
+        cmd.AddValue("duration", "simulated time", duration);
+        cmd.AddValue("loops", "comma separated list of per-event, run-until", loops);
+        cmd.AddValue("scheduler", "event scheduler of the simulator", scheduler);
+        cmd.Parse(argc, argv);
+
+        GlobalValue::Bind("SchedulerType", StringValue(scheduler));
+        std::stringstream list(loops);
+        std::string loop;
+        while (std::getline(list, loop, ',')) {
+            double seconds = 0;
+            const uint64_t events = RunWindows(loop, timers, period, window, duration, seconds);
+            std::cout << loop << ": events=" << events << " windows=" << duration.GetTimeStep() / window.GetTimeStep()
+                    << " wall=" << seconds << "s"
+                    << " per event=" << (events > 0 ? seconds * 1e9 / events : 0) << "ns" << std::endl;
+        }
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
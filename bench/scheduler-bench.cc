@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Replays the insertions of a recorded or synthetic run on the ns-3 event schedulers. A trace holds one
+ * "current time, event time" pair per scheduled event, as written by MosaicSimulatorImpl with the global
+ * EventTraceFile. Before each insertion, all events up to its current time are removed, so every scheduler
+ * sees the same sequence of insertions and removals as in the recorded run, without running any events.
+ *
+ * Without a trace, the timestamps are synthesized: per node one 1 ms periodic event like an LTE subframe,
+ * and one event with short PHY/MAC delays or longer exponential application delays.
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <sstream>
+
+#include "ns3/command-line.h"
+#include "ns3/object-factory.h"
+#include "ns3/scheduler.h"
+
+namespace ns3 {
+namespace bench {
+
+    namespace {
+
+        struct Record {
+            uint64_t now;
+            uint64_t ts;
+        };
+
+        std::vector<Record> LoadTrace(const std::string &file) {
+            std::ifstream in(file);
+            if (!in.good()) {
+                std::cerr << "Could not open trace " << file << std::endl;
+                exit(1);
+            }
+            std::vector<Record> trace;
+            Record record;
+            while (in >> record.now >> record.ts) {
+                trace.push_back(record);
+            }
+            return trace;
+        }
+
+        std::vector<Record> SynthesizeTrace(uint32_t nodes, uint64_t duration, uint32_t seed) {
+            const uint64_t period = 1000000; // 1 ms
+            std::mt19937_64 random(seed);
+            std::uniform_int_distribution<uint64_t> phyDelay(0, 100000);
+            std::exponential_distribution<double> appDelay(1.0 / 5000000);
+            std::bernoulli_distribution isPhy(0.4);
+
+            // pending events by time, odd tags are the periodic ones
+            typedef std::pair<uint64_t, uint32_t> Pending;
+            std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+            std::vector<Record> trace;
+            for (uint32_t i = 0; i < nodes; i++) {
+                const uint64_t phase = period * i / nodes;
+                pending.emplace(phase, 2 * i + 1);
+                pending.emplace(phase, 2 * i);
+                trace.push_back({0, phase});
+                trace.push_back({0, phase});
+            }
+            while (!pending.empty() && pending.top().first < duration) {
+                const Pending next = pending.top();
+                pending.pop();
+                const uint64_t delay = (next.second & 1) ? period
+                        : (isPhy(random) ? phyDelay(random) : static_cast<uint64_t>(appDelay(random)));
+                pending.emplace(next.first + delay, next.second);
+                trace.push_back({next.first, next.first + delay});
+            }
+            return trace;
+        }
+
+        /**
+         * Replays the trace and returns the wall time in seconds.
+         */
+        double Replay(const std::string &scheduler, const std::vector<Record> &trace, size_t &maxSize) {
+            ObjectFactory factory;
+            factory.SetTypeId(scheduler);
+            Ptr<Scheduler> events = factory.Create<Scheduler>();
+
+            size_t size = 0;
+            maxSize = 0;
+            uint32_t uid = 4;
+            const Clock::time_point start = Clock::now();
+            for (const Record &record : trace) {
+                while (!events->IsEmpty() && events->PeekNext().key.m_ts <= record.now) {
+                    events->RemoveNext();
+                    size--;
+                }
+                Scheduler::Event ev;
+                ev.impl = nullptr;
+                ev.key.m_ts = record.ts;
+                ev.key.m_uid = uid++;
+                ev.key.m_context = 0;
+                events->Insert(ev);
+                maxSize = std::max(maxSize, ++size);
+            }
+            while (!events->IsEmpty()) {
+                events->RemoveNext();
+            }
+            return SecondsSince(start);
+        }
+
+    } // namespace
+
+    int RunSchedulerBench(int argc, char *argv[]) {
+        std::string traceFile;
+        uint32_t nodes = 200;
+        Time duration = Seconds(5);
+        uint32_t seed = 1;
+        std::string schedulers = "ns3::ListScheduler,ns3::MapScheduler,ns3::HeapScheduler,ns3::CalendarScheduler,ns3::MosaicCalendarScheduler";
+
+        CommandLine cmd;
+        cmd.Usage("Replays recorded or synthetic event timestamps on the event schedulers.");
+        cmd.AddValue("trace", "file written with the global EventTraceFile, synthetic timestamps if empty", traceFile);
+        cmd.AddValue("nodes", "synthetic: number of nodes", nodes);
+        cmd.AddValue("duration", "synthetic: simulated time", duration);
+        cmd.AddValue("seed", "synthetic: seed of the random delays", seed);
+        cmd.AddValue("schedulers", "comma separated list of scheduler types", schedulers);
+        cmd.Parse(argc, argv);
+
+        const std::vector<Record> trace = traceFile.empty()
+                ? SynthesizeTrace(nodes, duration.GetNanoSeconds(), seed)
+                : LoadTrace(traceFile);
+        std::cout << "events=" << trace.size() << (traceFile.empty() ? " (synthetic)" : " from " + traceFile) << std::endl;
+
+        std::stringstream list(schedulers);
+        std::string scheduler;
+        while (std::getline(list, scheduler, ',')) {
+            size_t maxSize = 0;
+            const double seconds = Replay(scheduler, trace, maxSize);
+            std::cout << scheduler << ": wall=" << seconds << "s"
+                    << " per event=" << (trace.empty() ? 0 : seconds * 1e9 / trace.size()) << "ns"
+                    << " max pending=" << maxSize << std::endl;
+        }
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Round trip latency of one ADVANCE_TIME/END cycle, as seen by the ambassador: ADVANCE_TIME and the
+ * time are written on the ambassador->federate channel, END and the time are read from the
+ * federate->ambassador channel. Both sides use ClientServerChannel, the federate side runs in a
+ * second thread and answers like MosaicNs3Bridge without running any events. The shm transport
+ * connects over unix domain sockets and then switches all four channels to shared memory segments,
+ * the federate side creating them and the ambassador side attaching, as after a successful INIT.
+ */
+
+#include "bench.h"
+
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include "ns3/command-line.h"
+
+#include "client-server-channel.h"
+#include "shared-memory-transport.h"
+
+namespace ns3 {
+namespace bench {
+
+    using namespace ClientServerChannelSpace;
+
+    namespace {
+
+        /**
+         * The federate side: answers each ADVANCE_TIME with END until anything else is received.
+         */
+        void AnswerAdvanceTime(ClientServerChannel *federateAmbassador, ClientServerChannel *ambassadorFederate) {
+            while (ambassadorFederate->readCommand() == CommandMessage_CommandType_ADVANCE_TIME) {
+                const int64_t time = ambassadorFederate->readTimeMessage();
+                federateAmbassador->writeCommand(CommandMessage_CommandType_END);
+                federateAmbassador->writeTimeMessage(time);
+                federateAmbassador->flush();
+            }
+        }
+
+        /**
+         * Runs warmup + rounds round trips over the given transport and returns the latency of each measured round in microseconds.
+         */
+        std::vector<double> MeasureRoundTrips(const std::string &transport, uint32_t warmup, uint32_t rounds, const std::string &socketPath) {
+            // federate side, listening
+            ClientServerChannel federateAmbassador;
+            ClientServerChannel ambassadorFederate;
+            // ambassador side, connecting
+            ClientServerChannel ambassadorOut;
+            ClientServerChannel ambassadorCmd;
+
+            bool connected;
+            if (transport == "tcp") {
+                const int port = federateAmbassador.prepareConnection("127.0.0.1", 0);
+                const int cmdPort = ambassadorFederate.prepareConnection("127.0.0.1", 0);
+                connected = ambassadorOut.connectTo("127.0.0.1", port) && ambassadorCmd.connectTo("127.0.0.1", cmdPort);
+            } else if (transport == "uds" || transport == "shm") {
+                federateAmbassador.prepareUnixConnection(socketPath);
+                ambassadorFederate.prepareUnixConnection(socketPath + ".cmd");
+                connected = ambassadorOut.connectToUnix(socketPath) && ambassadorCmd.connectToUnix(socketPath + ".cmd");
+            } else {
+                std::cerr << "Unknown transport " << transport << std::endl;
+                exit(1);
+            }
+            if (!connected) {
+                std::cerr << "Could not connect the " << transport << " channels" << std::endl;
+                exit(1);
+            }
+            // pending connections are accepted from the backlog
+            federateAmbassador.connect();
+            ambassadorFederate.connect();
+            if (transport == "shm") {
+                const std::string name = "/mosaic-bench-" + std::to_string(getpid());
+                federateAmbassador.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(new SharedMemoryTransport(name)));
+                ambassadorFederate.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(new SharedMemoryTransport(name + ".cmd")));
+                ambassadorOut.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(new SharedMemoryTransport(name, SharedMemoryTransport::AMBASSADOR)));
+                ambassadorCmd.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(new SharedMemoryTransport(name + ".cmd", SharedMemoryTransport::AMBASSADOR)));
+            }
+
+            std::thread federate(&AnswerAdvanceTime, &federateAmbassador, &ambassadorFederate);
+
+            std::vector<double> samples;
+            samples.reserve(rounds);
+            for (uint32_t i = 0; i < warmup + rounds; i++) {
+                const int64_t time = (i + 1) * 1000000LL;
+                const Clock::time_point start = Clock::now();
+                ambassadorCmd.writeCommand(CommandMessage_CommandType_ADVANCE_TIME);
+                ambassadorCmd.writeTimeMessage(time);
+                ambassadorCmd.flush();
+                if (ambassadorOut.readCommand() != CommandMessage_CommandType_END || ambassadorOut.readTimeMessage() != time) {
+                    std::cerr << "Unexpected answer to ADVANCE_TIME " << time << std::endl;
+                    exit(1);
+                }
+                if (i >= warmup) {
+                    samples.push_back(SecondsSince(start) * 1e6);
+                }
+            }
+
+            ambassadorCmd.writeCommand(CommandMessage_CommandType_SHUT_DOWN);
+            ambassadorCmd.flush();
+            federate.join();
+            return samples;
+        }
+
+    } // namespace
+
+    int RunTransportBench(int argc, char *argv[]) {
+        uint32_t rounds = 100000;
+        uint32_t warmup = 1000;
+        std::string transports = "tcp,uds,shm";
+        std::string socketPath = "/tmp/mosaic-bench.sock";
+
+        CommandLine cmd;
+        cmd.Usage("ADVANCE_TIME/END round trip latency over the ClientServerChannel transports.");
+        cmd.AddValue("rounds", "number of measured round trips per transport", rounds);
+        cmd.AddValue("warmup", "number of round trips before the measurement", warmup);
+        cmd.AddValue("transports", "comma separated list of tcp, uds, shm", transports);
+        cmd.AddValue("socketPath", "path of the unix domain sockets", socketPath);
+        cmd.Parse(argc, argv);
+
+        std::stringstream list(transports);
+        std::string transport;
+        while (std::getline(list, transport, ',')) {
+            std::vector<double> samples = MeasureRoundTrips(transport, warmup, rounds, socketPath);
+            PrintDistribution(transport + " round trip", samples, "us");
+        }
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Cost of a Wifi broadcast against the number of vehicles: Wifi-only vehicles are placed on a grid
+ * through MosaicNodeManager, a fixed number of them sends one CCH broadcast each at a random time.
+ * With the plain YansWifiChannel every transmission schedules a reception on every PHY, with
+ * MosaicWifiChannel (premake5 --wifi-grid-channel) and MaxRange above 0 only on the PHYs in range.
+ * Without the grid channel only MaxRange 0 can be measured, other values are rejected.
+ * Each case runs in a forked child process, as the ns-3 globals, the simulator and the node list
+ * cannot be reset in between. No bridge is attached, the node manager only counts the receptions.
+ */
+
+#include "bench.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "ns3/boolean.h"
+#include "ns3/command-line.h"
+#include "ns3/config.h"
+#include "ns3/double.h"
+#include "ns3/global-value.h"
+#include "ns3/simulator.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+
+#include "mosaic-node-manager.h"
+#include "mosaic-simulator-impl.h"
+
+namespace ns3 {
+namespace bench {
+
+    namespace {
+
+        void MeasureWifiChannel(uint32_t nodes, double maxRange, uint32_t senders, double spacing, Time duration, uint32_t seed) {
+            GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::MosaicSimulatorImpl"));
+            Config::SetDefault("ns3::MosaicNodeManager::numExtraRadioNodes", UintegerValue(0));
+            Config::SetDefault("ns3::MosaicNodeManager::LazyLteSetup", BooleanValue(true));
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+            Config::SetDefault("ns3::MosaicWifiChannel::MaxRange", DoubleValue(maxRange));
+#endif
+            Ptr<MosaicSimulatorImpl> sim = DynamicCast<MosaicSimulatorImpl>(Simulator::GetImplementation());
+
+            const Clock::time_point setupStart = Clock::now();
+            Ptr<MosaicNodeManager> nodeManager = CreateObject<MosaicNodeManager>();
+            nodeManager->Configure(nullptr);
+            const uint32_t columns = 200;
+            for (uint32_t i = 0; i < nodes; i++) {
+                nodeManager->CreateRadioNode(i, Vector(spacing * (i % columns), spacing * (i / columns), 0), MosaicNodeManager::RADIO_PROFILE_WIFI_ONLY);
+            }
+            nodeManager->OnStart();
+            for (uint32_t i = 0; i < nodes; i++) {
+                nodeManager->ConfigureWifiRadio(i, -1, Ipv4Address(Ipv4Address("10.1.0.0").Get() + i + 1));
+            }
+            // the senders are spread evenly over the grid, each sends once at a random time
+            std::mt19937 random(seed);
+            std::uniform_int_distribution<uint64_t> sendTime(0, duration.GetTimeStep() - 1);
+            const Ipv4Address broadcast("10.255.255.255");
+            for (uint32_t i = 0; i < senders; i++) {
+                Simulator::Schedule(TimeStep(sendTime(random)), &MosaicNodeManager::SendWifiMsg, nodeManager,
+                        static_cast<uint32_t>(static_cast<uint64_t>(i) * nodes / senders), broadcast,
+                        ClientServerChannelSpace::RadioChannel::PROTO_CCH, i, 200);
+            }
+            const double setupSeconds = SecondsSince(setupStart);
+
+            const Clock::time_point runStart = Clock::now();
+            // run past the duration, so that the last transmissions are received
+            const uint64_t events = sim->RunUntil((duration + MilliSeconds(10)).GetTimeStep(), std::function<bool()>());
+            const double runSeconds = SecondsSince(runStart);
+
+            std::cout << "nodes=" << nodes << " maxRange=" << maxRange << "m"
+                    << " setup=" << setupSeconds << "s"
+                    << " run=" << runSeconds << "s"
+                    << " per transmission=" << runSeconds * 1e3 / senders << "ms"
+                    << " events=" << events
+                    << " receptions=" << nodeManager->GetCountReceivedMessages() << std::endl;
+        }
+
+    } // namespace
+
+    int RunWifiChannelBench(int argc, char *argv[]) {
+        std::string nodeCounts = "1000,5000,20000";
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+        std::string maxRanges = "0,500";
+#else
+        std::string maxRanges = "0";
+#endif
+        uint32_t senders = 100;
+        double spacing = 50;
+        Time duration = Seconds(1);
+        uint32_t seed = 1;
+
+        CommandLine cmd;
+        cmd.Usage("Wifi broadcasts of a fixed number of senders among 1k to 20k vehicles, plain against grid culled channel.");
+        cmd.AddValue("nodes", "comma separated list of vehicle counts", nodeCounts);
+        cmd.AddValue("maxRanges", "comma separated list of MosaicWifiChannel::MaxRange values in m, 0 delivers to all PHYs", maxRanges);
+        cmd.AddValue("senders", "number of vehicles sending one broadcast each", senders);
+        cmd.AddValue("spacing", "distance in m between neighbouring vehicles on the grid", spacing);
+        cmd.AddValue("duration", "simulated time in which the broadcasts are sent", duration);
+        cmd.AddValue("seed", "seed of the send times", seed);
+        cmd.Parse(argc, argv);
+
+        std::stringstream nodeList(nodeCounts);
+        std::string nodeCount;
+        while (std::getline(nodeList, nodeCount, ',')) {
+            std::stringstream rangeList(maxRanges);
+            std::string maxRange;
+            while (std::getline(rangeList, maxRange, ',')) {
+#ifndef MOSAIC_WIFI_GRID_CHANNEL
+                if (std::stod(maxRange) > 0) {
+                    // the YansWifiChannel would deliver to all PHYs, which is not what was asked for
+                    std::cerr << "MaxRange " << maxRange << " requires the build with premake5 --wifi-grid-channel" << std::endl;
+                    return 1;
+                }
+#endif
+                const uint32_t nodes = std::stoul(nodeCount);
+                std::cout.flush();
+                const pid_t child = fork();
+                if (child == 0) {
+                    MeasureWifiChannel(nodes, std::stod(maxRange), std::min(senders, nodes), spacing, duration, seed);
+                    std::cout.flush();
+                    _exit(0);
+                }
+                int status = 0;
+                if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                    std::cerr << "Measurement of " << nodes << " nodes with MaxRange " << maxRange << " failed" << std::endl;
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+} // namespace bench
+} // namespace ns3
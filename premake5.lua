@@ -16,21 +16,30 @@ newoption {
     description = "Generate/Regenerate protocol buffers with protobuf compiler"
 }
 
-workspace "ns3-federate"
-    configurations { "Debug", "Release" }
+newoption {
+    trigger     = "count-allocations",
+    description = "Count heap allocations, e.g. to verify that decoding commands does not allocate"
+}
 
-project "ns3-federate"
-    kind "ConsoleApp"
-    language "C++"
-    targetdir "bin/%{cfg.buildcfg}"
-    buildoptions { "-std=c++17" }
+newoption {
+    trigger     = "wifi-grid-channel",
+    description = "Use MosaicWifiChannel for Wifi, requires ns-3 patched with patches/ns3-yans-wifi-channel.patch"
+}
 
-    files { "src/**.h"
-          , "src/**.cc" 
-          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.h"
-          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.cc"
-          }
+-- the patch changes the vtable of YansWifiChannel, so it can not be applied here without rebuilding ns-3
+if _OPTIONS["wifi-grid-channel"] then
+    local NS3_INCLUDE_PATH = "../ns-allinone-" .. ns3version .. "/ns-" .. ns3version .. "/build/include"
+    local hint = "--wifi-grid-channel requires ns-3 patched with patches/ns3-yans-wifi-channel.patch and rebuilt: "
+              .. "patch -p1 -d ../ns-allinone-" .. ns3version .. "/ns-" .. ns3version .. " < patches/ns3-yans-wifi-channel.patch"
+    tools.check_contains ( NS3_INCLUDE_PATH .. "/ns3/yans-wifi-channel.h", "virtual void Add (Ptr<YansWifiPhy> phy);", hint )
+    tools.check_contains ( NS3_INCLUDE_PATH .. "/ns3/yans-wifi-channel.h", "virtual void Send (Ptr<YansWifiPhy> sender", hint )
+end
+
+workspace "ns3-federate"
+    configurations { "Debug", "Release" }
 
+-- include paths, ns-3 libraries and defines shared by all projects
+local function use_ns3 ()
     includedirs { "/usr/include"
                 , "/usr/include/libxml2"
                 , "src"
@@ -45,13 +54,19 @@ project "ns3-federate"
     links { "pthread"
           , "protobuf"
           , "xml2"
+          , "rt"
           }
 
-    filter "options:generate-protobuf"
-        prebuildcommands { PROTOC .. " --cpp_out=" .. PROTO_CC_PATH
-                                  .. " --proto_path=" .. PROTO_PATH
-                                  .. " ClientServerChannelMessages.proto"
-                         }
+    filter "options:count-allocations"
+        defines { "MOSAIC_COUNT_ALLOCATIONS" }
+
+    filter "options:wifi-grid-channel"
+        defines { "MOSAIC_WIFI_GRID_CHANNEL" }
+
+    filter "not options:wifi-grid-channel"
+        removefiles { "src/mosaic-wifi-channel.h"
+                    , "src/mosaic-wifi-channel.cc"
+                    }
 
     filter "configurations:Debug"
         defines { "DEBUG"
@@ -144,3 +159,66 @@ project "ns3-federate"
               , "ns3" .. ns3version .. "wifi-optimized"
               -- , "ns3" .. ns3version .. "wimax-optimized"
               }
+
+    filter {}
+end
+
+project "ns3-federate"
+    kind "ConsoleApp"
+    language "C++"
+    targetdir "bin/%{cfg.buildcfg}"
+    buildoptions { "-std=c++17" }
+
+    files { "src/**.h"
+          , "src/**.cc" 
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.h"
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.cc"
+          }
+
+    use_ns3 ()
+
+    filter "options:generate-protobuf"
+        prebuildcommands { PROTOC .. " --cpp_out=" .. PROTO_CC_PATH
+                                  .. " --proto_path=" .. PROTO_PATH
+                                  .. " ClientServerChannelMessages.proto"
+                         }
+
+    filter {}
+
+-- standalone benchmark drivers, e.g. bin/Release/bench transport --rounds=100000
+project "bench"
+    kind "ConsoleApp"
+    language "C++"
+    targetdir "bin/%{cfg.buildcfg}"
+    buildoptions { "-std=c++17" }
+
+    files { "bench/**.h"
+          , "bench/**.cc"
+          , "src/**.h"
+          , "src/**.cc"
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.h"
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.cc"
+          }
+    removefiles { "src/main.cc" }
+
+    use_ns3 ()
+
+-- stand-in of the ambassador for the shared memory transport, e.g. bin/Release/shm-peer --sharedMemory=/mosaic
+project "shm-peer"
+    kind "ConsoleApp"
+    language "C++"
+    targetdir "bin/%{cfg.buildcfg}"
+    buildoptions { "-std=c++17" }
+
+    files { "tools/shm-peer.cc"
+          , "src/client-server-channel.h"
+          , "src/client-server-channel.cc"
+          , "src/shared-memory-transport.h"
+          , "src/shared-memory-transport.cc"
+          , "src/allocation-counter.h"
+          , "src/allocation-counter.cc"
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.h"
+          , PROTO_CC_PATH .. "/ClientServerChannelMessages.pb.cc"
+          }
+
+    use_ns3 ()
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+namespace ns3 {
+
+    /**
+     * @brief Returns the number of heap allocations done via operator new so far
+     *
+     * Counting requires to build with the premake option --count-allocations, which defines
+     * MOSAIC_COUNT_ALLOCATIONS and replaces all global operator new/delete variants (including new[],
+     * aligned and nothrow). Otherwise this is always zero.
+     */
+    uint64_t GetHeapAllocationCount(void);
+
+    /**
+     * @brief Returns true, if heap allocations are counted in this build
+     */
+    bool IsHeapAllocationCountEnabled(void);
+
+} // namespace ns3
+#endif /* ALLOCATION_COUNTER_H */
@@ -22,24 +22,30 @@
 
 #include "client-server-channel.h"
 
+#include "allocation-counter.h"
+
 #include <arpa/inet.h>
 #include <google/protobuf/message.h>
-#include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <iostream>
 #include <netdb.h>
 #include <errno.h>
 #include <iomanip>
-#include <poll.h>
+#include <algorithm>
+#include <cstring>
 
 #include <ns3/log.h>
 
 NS_LOG_COMPONENT_DEFINE("ClientServerChannel");
 
+using google::protobuf::internal::WireFormatLite;
+
 namespace std {
     ostream& operator<< ( ostream& out, ClientServerChannelSpace::CommandMessage_CommandType cmd ) {
         switch ( cmd ) {
@@ -50,15 +56,21 @@ namespace std {
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_NEXT_EVENT: out << "CommandType_NEXT_EVENT"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_ADVANCE_TIME: out << "CommandType_ADVANCE_TIME"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_END: out << "CommandType_END"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_ADVANCE_TIME_STEPS: out << "CommandType_ADVANCE_TIME_STEPS"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_STEP_END: out << "CommandType_STEP_END"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_ADD_NODE: out << "CommandType_ADD_NODE"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_UPDATE_NODE: out << "CommandType_UPDATE_NODE"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_REMOVE_NODE: out << "CommandType_REMOVE_NODE"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_UPDATE_NODE_PACKED: out << "CommandType_UPDATE_NODE_PACKED"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_CONF_WIFI_RADIO: out << "CommandType_CONF_WIFI_RADIO"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_SEND_WIFI_MSG: out << "CommandType_SEND_WIFI_MSG"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_RECV_WIFI_MSG: out << "CommandType_RECV_WIFI_MSG"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_RECV_WIFI_MSG_BATCH: out << "CommandType_RECV_WIFI_MSG_BATCH"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_CONF_CELL_RADIO: out << "CommandType_CONF_CELL_RADIO"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_SEND_CELL_MSG: out << "CommandType_SEND_CELL_MSG"; break;
             case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_RECV_CELL_MSG: out << "CommandType_RECV_CELL_MSG"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_RECV_CELL_MSG_BATCH: out << "CommandType_RECV_CELL_MSG_BATCH"; break;
+            case ClientServerChannelSpace::CommandMessage_CommandType::CommandMessage_CommandType_COMMAND_BATCH: out << "CommandType_COMMAND_BATCH"; break;
         }
         return out;
     }
@@ -79,9 +91,15 @@ std::string uint32_to_ip ( const unsigned int ip ) {
     return out;
 }
 
+/** Initial capacity of the receive buffer, large enough to hold many small frames at once. */
+constexpr const size_t RECV_BUFFER_SIZE = 64 * 1024;
+
 ClientServerChannel::ClientServerChannel() {
     servsock = INVALID_SOCKET;
     sock = INVALID_SOCKET;
+    recvBuffer.resize(RECV_BUFFER_SIZE);
+    recvBegin = 0;
+    recvEnd = 0;
 }
 
 int ClientServerChannel::prepareConnection ( std::string host, uint32_t port ) {
@@ -143,9 +161,44 @@ int ClientServerChannel::prepareConnection ( std::string host, uint32_t port ) {
     return assigned_port;
 }
 
+void ClientServerChannel::prepareUnixConnection ( std::string path ) {
+    NS_LOG_FUNCTION(this << path.c_str());
+
+    // assemble servaddr
+    sockaddr_un servaddr;
+    memset( (char*)&servaddr, 0, sizeof(servaddr) );
+    servaddr.sun_family = AF_UNIX;
+    if ( path.empty() || path.size() >= sizeof(servaddr.sun_path) ) {
+        std::cerr << "Error: ClientServerChannel got invalid socket path: " << path.c_str() << std::endl;
+        exit(1);
+    }
+    strncpy ( servaddr.sun_path, path.c_str(), sizeof(servaddr.sun_path) - 1 );
+
+    // create socket
+    servsock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (servsock < 0) {
+        std::cerr << "Error: ClientServerChannel could not create socket to connect - " << strerror(errno) << std::endl;
+        exit(1);
+    }
+    NS_LOG_DEBUG("servsock=" << servsock);
+
+    // remove a stale socket file of a previous run, bind would fail otherwise
+    unlink ( path.c_str() );
+
+    // bind
+    if ( bind ( servsock, (struct sockaddr*) &servaddr, sizeof(servaddr) ) < 0) {
+        std::cerr << "Error: ClientServerChannel could not bind socket - " << strerror(errno) << std::endl;
+        exit(1);
+    }
+    socketPath = path;
+
+    // listen
+    listen(servsock, 3);
+}
+
 void ClientServerChannel::connect(void) {
     NS_LOG_FUNCTION(this);
-    sockaddr_in clientaddr;
+    sockaddr_storage clientaddr;
     size_t len = sizeof(clientaddr);
     sock = accept ( servsock, (struct sockaddr*) &clientaddr, (socklen_t*) &len ); 
 
@@ -153,10 +206,80 @@ void ClientServerChannel::connect(void) {
         std::cerr << "Error: ClientServerChannel could not accept connection from Ambassador - " << strerror(errno) << std::endl;
     }
     NS_LOG_DEBUG("sock=" << sock);
-    NS_LOG_DEBUG("clientaddr: " << uint32_to_ip(clientaddr.sin_addr.s_addr) << ":" << ntohs(clientaddr.sin_port));
 
+    if (clientaddr.ss_family == AF_INET) {
+        const sockaddr_in* clientaddr_in = (const sockaddr_in*) &clientaddr;
+        NS_LOG_DEBUG("clientaddr: " << uint32_to_ip(clientaddr_in->sin_addr.s_addr) << ":" << ntohs(clientaddr_in->sin_port));
+
+        int x = 1;
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&x, sizeof(x));
+    } else {
+        NS_LOG_DEBUG("clientaddr: " << socketPath);
+    }
+}
+
+bool ClientServerChannel::connectTo ( std::string host, uint32_t port ) {
+    NS_LOG_FUNCTION(this << host.c_str() << port);
+
+    struct hostent* host_ent;
+    in_addr addr;
+    addr.s_addr = inet_addr ( host.c_str() );
+    if ( addr.s_addr == static_cast < unsigned int > ( -1 ) ) {
+        if ( !( host_ent = gethostbyname ( host.c_str() ) ) ) {
+            std::cerr << "Error: ClientServerChannel got invalid host address: " << host.c_str() << std::endl;
+            exit(1);
+        }
+        addr = *( ( struct in_addr* ) host_ent->h_addr_list[0] );
+    }
+
+    sockaddr_in servaddr;
+    memset( (char*)&servaddr, 0, sizeof(servaddr) );
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(port);
+    servaddr.sin_addr.s_addr = addr.s_addr;
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        std::cerr << "Error: ClientServerChannel could not create socket to connect - " << strerror(errno) << std::endl;
+        exit(1);
+    }
+    if ( ::connect ( sock, (struct sockaddr*) &servaddr, sizeof(servaddr) ) < 0 ) {
+        NS_LOG_DEBUG("connect to " << host << ":" << port << " failed - " << strerror(errno));
+        close(sock);
+        sock = INVALID_SOCKET;
+        return false;
+    }
     int x = 1;
     setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&x, sizeof(x));
+    NS_LOG_DEBUG("sock=" << sock);
+    return true;
+}
+
+bool ClientServerChannel::connectToUnix ( std::string path ) {
+    NS_LOG_FUNCTION(this << path.c_str());
+
+    sockaddr_un servaddr;
+    memset( (char*)&servaddr, 0, sizeof(servaddr) );
+    servaddr.sun_family = AF_UNIX;
+    if ( path.empty() || path.size() >= sizeof(servaddr.sun_path) ) {
+        std::cerr << "Error: ClientServerChannel got invalid socket path: " << path.c_str() << std::endl;
+        exit(1);
+    }
+    strncpy ( servaddr.sun_path, path.c_str(), sizeof(servaddr.sun_path) - 1 );
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        std::cerr << "Error: ClientServerChannel could not create socket to connect - " << strerror(errno) << std::endl;
+        exit(1);
+    }
+    if ( ::connect ( sock, (struct sockaddr*) &servaddr, sizeof(servaddr) ) < 0 ) {
+        NS_LOG_DEBUG("connect to " << path << " failed - " << strerror(errno));
+        close(sock);
+        sock = INVALID_SOCKET;
+        return false;
+    }
+    NS_LOG_DEBUG("sock=" << sock);
+    return true;
 }
 
 ClientServerChannel::~ClientServerChannel() {
@@ -168,6 +291,21 @@ ClientServerChannel::~ClientServerChannel() {
         close(servsock);
         servsock = INVALID_SOCKET;
     }
+    if (!socketPath.empty()) {
+        unlink(socketPath.c_str());
+    }
+}
+
+void ClientServerChannel::switchToSharedMemory(std::unique_ptr < SharedMemoryTransport > transport) {
+    if ( recvBegin != recvEnd || !sendBuffer.empty() ) {
+        NS_LOG_ERROR("Cannot switch to shared memory segment " << transport->getName() << " with " << (recvEnd - recvBegin)
+                     << " unread and " << sendBuffer.size() << " unsent bytes");
+        exit(1);
+    }
+    NS_LOG_INFO("Switching from socket " << sock << " to shared memory segment " << transport->getName());
+    // the socket stays open, a closed socket tells the transport that the peer is gone
+    transport->setPeerSocket ( sock );
+    sharedMemory = std::move ( transport );
 }
 
 //#####################################################
@@ -191,245 +329,310 @@ std::string debug_byte_array ( const char* buffer, const size_t message_size ) {
     return array.str();
 }
 
-CommandMessage_CommandType ClientServerChannel::readCommand() {
-    NS_LOG_FUNCTION(this);
-    //Read the mandatory prefixed size
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix ( sock );
-    if ( !message_size || *message_size < 0 ) {
-        NS_LOG_ERROR("Reading of mandatory message size failed!");
-        return CommandMessage_CommandType_UNDEF;
-    }
-    NS_LOG_LOGIC("read command announced message size: " << *message_size);
-    //Allocate a fitting buffer and read message from stream
-    char message_buffer[*message_size];
-    size_t res = recv ( sock, message_buffer, *message_size, MSG_WAITALL );
-    NS_LOG_LOGIC("readCommand recv result: " << res);
-    if ( *message_size > 0 && res != *message_size ) {
-        NS_LOG_ERROR("ERROR: expected " << *message_size << " bytes, but read " << res << " bytes. poll ... ");
-        struct pollfd socks[1];
-        socks[0].fd = sock;
-        socks[0].events = POLLRDNORM | POLLERR;
-        socks[0].revents = 0;
-        int poll_res = 0;
-        int retries = 3;
-        do {
-            poll_res = poll(socks, 1, 1000);
-            NS_LOG_LOGIC("poll res: " << poll_res);
-            retries--;
-            if ( retries == 0) { break; }
-            sleep(1);
-            NS_LOG_LOGIC("poll ...");
-        } while ( poll_res < 1 );
-        res = recv ( sock, message_buffer, *message_size, MSG_WAITALL );
-        if ( retries != 3 && res < 1 ) {
-            NS_LOG_ERROR("ERROR: socket is ready, but cannot receive any bytes (" << res << "). Message sent?");
-            return CommandMessage_CommandType_UNDEF;
+bool ClientServerChannel::readFrame(const char*& data, uint32_t& size) {
+    size = 0;
+    if ( !readVarintPrefix ( size ) ) {
+        NS_LOG_ERROR("Cannot access message size");
+        return false;
+    }
+    NS_LOG_LOGIC("read announced message size: " << size);
+    if ( !bufferFrame ( size ) ) {
+        NS_LOG_ERROR("Expected " << size << " bytes, but connection closed");
+        return false;
+    }
+    // the frame is consumed regardless of whether it can be parsed
+    data = recvBuffer.data() + recvBegin;
+    recvBegin += size;
+    statistics.framesRead++;
+    NS_LOG_LOGIC("message buffer as byte array: " << debug_byte_array ( data, size ));
+    return true;
+}
+
+template < typename T >
+bool ClientServerChannel::readMessage(T& message) {
+    const char* message_buffer;
+    uint32_t message_size;
+    if ( !readFrame ( message_buffer, message_size ) ) {
+        return false;
+    }
+    // parse directly from the receive buffer
+    const uint64_t allocations_before = ns3::GetHeapAllocationCount();
+    const bool success = message.ParseFromArray ( message_buffer, message_size );
+    statistics.decodeAllocations += ns3::GetHeapAllocationCount() - allocations_before;
+    if ( !success ) {
+        NS_LOG_ERROR("Could not parse " << message.GetTypeName() << " from " << message_size << " bytes");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Reads a repeated varint field, which is either packed (length delimited) or a single element.
+ */
+template < typename F >
+static bool readVarints ( google::protobuf::io::CodedInputStream& input, WireFormatLite::WireType wire_type, F consume ) {
+    uint64_t value;
+    if ( wire_type == WireFormatLite::WIRETYPE_VARINT ) {
+        if ( !input.ReadVarint64 ( &value ) ) {
+            return false;
         }
+        consume ( value );
+        return true;
     }
-    if ( res != *message_size ) {
-        NS_LOG_ERROR("ERROR: reading of message body failed! Socket not ready.");
-        return CommandMessage_CommandType_UNDEF;
+    uint32_t length;
+    if ( wire_type != WireFormatLite::WIRETYPE_LENGTH_DELIMITED || !input.ReadVarint32 ( &length ) ) {
+        return false;
+    }
+    const auto limit = input.PushLimit ( length );
+    while ( input.BytesUntilLimit() > 0 ) {
+        if ( !input.ReadVarint64 ( &value ) ) {
+            return false;
+        }
+        consume ( value );
     }
-    if ( *message_size > 0 ) {
-        NS_LOG_LOGIC("message buffer as byte array: " << debug_byte_array ( message_buffer, *message_size ));
-        //Create the streams that can parse the received data into the protobuf class
-        google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-        google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
+    input.PopLimit ( limit );
+    return true;
+}
 
-        CommandMessage commandMessage;
-        commandMessage.ParseFromCodedStream(&codedIn);  //parse message
-        //pick the needed data from the protobuf message class and return it
-        const CommandMessage_CommandType cmd = commandMessage.command_type();
-        NS_LOG_LOGIC("read command: " << cmd);
-        return cmd;
+static bool readDouble ( google::protobuf::io::CodedInputStream& input, WireFormatLite::WireType wire_type, double& value ) {
+    uint64_t bits;
+    if ( wire_type != WireFormatLite::WIRETYPE_FIXED64 || !input.ReadLittleEndian64 ( &bits ) ) {
+        return false;
     }
-    return CommandMessage_CommandType_UNDEF;
+    value = WireFormatLite::DecodeDouble ( bits );
+    return true;
 }
 
-InitMessage ClientServerChannel::readInitMessage() {
-    NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
-        exit(1);
+/**
+ * Decodes an UpdateNodePacked message field by field into the arrays of the batch.
+ */
+static bool decodeUpdateNodePacked ( const char* data, uint32_t size, PositionBatch& batch ) {
+    google::protobuf::io::CodedInputStream input ( reinterpret_cast < const uint8_t* > ( data ), size );
+    batch.ids.clear();
+    batch.positions.clear();
+    batch.velocities.clear();
+
+    bool has_time = false;
+    double resolution = 0;
+    double origin_x = 0, origin_y = 0, origin_z = 0;
+    size_t x_count = 0, y_count = 0, z_count = 0;
+    size_t vx_count = 0, vy_count = 0, vz_count = 0;
+    uint32_t previous_id = 0;
+    auto position = [&batch] ( size_t index ) -> PositionBatch::Position& {
+        if ( index >= batch.positions.size() ) {
+            batch.positions.resize ( index + 1, PositionBatch::Position { 0, 0, 0 } );
+        }
+        return batch.positions[index];
+    };
+    auto velocity = [&batch] ( size_t index ) -> PositionBatch::Position& {
+        if ( index >= batch.velocities.size() ) {
+            batch.velocities.resize ( index + 1, PositionBatch::Position { 0, 0, 0 } );
+        }
+        return batch.velocities[index];
+    };
+
+    while ( const uint32_t tag = input.ReadTag() ) {
+        const WireFormatLite::WireType wire_type = WireFormatLite::GetTagWireType ( tag );
+        bool success;
+        switch ( WireFormatLite::GetTagFieldNumber ( tag ) ) {
+            case UpdateNodePacked::kTimeFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) { batch.time = static_cast < int64_t > ( value ); } );
+                has_time = success;
+                break;
+            case UpdateNodePacked::kResolutionFieldNumber:
+                success = readDouble ( input, wire_type, resolution );
+                break;
+            case UpdateNodePacked::kOriginXFieldNumber:
+                success = readDouble ( input, wire_type, origin_x );
+                break;
+            case UpdateNodePacked::kOriginYFieldNumber:
+                success = readDouble ( input, wire_type, origin_y );
+                break;
+            case UpdateNodePacked::kOriginZFieldNumber:
+                success = readDouble ( input, wire_type, origin_z );
+                break;
+            case UpdateNodePacked::kNodeIdDeltaFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    previous_id += static_cast < uint32_t > ( value );
+                    batch.ids.push_back ( previous_id );
+                } );
+                break;
+            case UpdateNodePacked::kXFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    position ( x_count++ ).x = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            case UpdateNodePacked::kYFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    position ( y_count++ ).y = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            case UpdateNodePacked::kZFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    position ( z_count++ ).z = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            case UpdateNodePacked::kVxFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    velocity ( vx_count++ ).x = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            case UpdateNodePacked::kVyFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    velocity ( vy_count++ ).y = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            case UpdateNodePacked::kVzFieldNumber:
+                success = readVarints ( input, wire_type, [&] ( uint64_t value ) {
+                    velocity ( vz_count++ ).z = WireFormatLite::ZigZagDecode32 ( static_cast < uint32_t > ( value ) );
+                } );
+                break;
+            default:
+                success = WireFormatLite::SkipField ( &input, tag );
+                break;
+        }
+        if ( !success ) {
+            NS_LOG_ERROR("Could not decode field " << WireFormatLite::GetTagFieldNumber ( tag ) << " of UpdateNodePacked");
+            return false;
+        }
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
-        exit(1);
+
+    const size_t count = batch.ids.size();
+    if ( !has_time || resolution <= 0 || x_count != count || y_count != count || ( z_count != 0 && z_count != count ) ) {
+        NS_LOG_ERROR("Inconsistent UpdateNodePacked: ids=" << count << " x=" << x_count << " y=" << y_count << " z=" << z_count
+                     << " resolution=" << resolution);
+        return false;
     }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
-        exit(1);
+    const size_t velocity_count = vx_count;
+    if ( vy_count != velocity_count || ( velocity_count != 0 && velocity_count != count ) || ( vz_count != 0 && vz_count != velocity_count ) ) {
+        NS_LOG_ERROR("Inconsistent UpdateNodePacked velocities: ids=" << count << " vx=" << vx_count << " vy=" << vy_count << " vz=" << vz_count);
+        return false;
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    InitMessage msg;
-    msg.ParseFromCodedStream ( &codedIn );
-    if (msg.protocol_version() != PROTOCOL_VERSION) {
-        NS_LOG_ERROR("Do not have correct protocol version. Have: " << msg.protocol_version() << " Require: " << PROTOCOL_VERSION);
-        exit(1);
+    batch.positions.resize ( count );
+    for ( PositionBatch::Position& p : batch.positions ) {
+        p.x = origin_x + p.x * resolution;
+        p.y = origin_y + p.y * resolution;
+        p.z = origin_z + p.z * resolution; // z stays 0 if not transmitted
     }
-    return msg;
+    batch.velocities.resize ( velocity_count );
+    for ( PositionBatch::Position& v : batch.velocities ) {
+        v.x *= resolution;
+        v.y *= resolution;
+        v.z *= resolution;
+    }
+    return true;
 }
 
-int64_t ClientServerChannel::readTimeMessage() {
+CommandMessage_CommandType ClientServerChannel::readCommand() {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
-        exit(1);
-    }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
-        exit(1);
-    }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
-        exit(1);
+    if ( !readMessage ( commandMessage ) ) {
+        NS_LOG_ERROR("Reading of command failed!");
+        return CommandMessage_CommandType_UNDEF;
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    TimeMessage msg;
-    msg.ParseFromCodedStream ( &codedIn );
-    return msg.time();
+    //pick the needed data from the protobuf message class and return it
+    const CommandMessage_CommandType cmd = commandMessage.command_type();
+    NS_LOG_LOGIC("read command: " << cmd);
+    return cmd;
 }
 
-AddNode ClientServerChannel::readAddNode(void) {
+InitMessage ClientServerChannel::readInitMessage() {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
-        exit(1);
-    }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
+    InitMessage msg;
+    if (!readMessage(msg)) {
         exit(1);
     }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
+    if (msg.protocol_version() < MIN_PROTOCOL_VERSION || msg.protocol_version() > PROTOCOL_VERSION) {
+        NS_LOG_ERROR("Do not have correct protocol version. Have: " << msg.protocol_version() << " Require: " << MIN_PROTOCOL_VERSION << ".." << PROTOCOL_VERSION);
         exit(1);
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-    // TODO: code until here is duplicated in the following functions. dedup!
-
-    AddNode msg;
-    msg.ParseFromCodedStream (&codedIn);
     return msg;
 }
 
-UpdateNode ClientServerChannel::readUpdateNode(void) {
+uint32_t ClientServerChannel::readPort() {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    PortExchange message;
+    if (!readMessage(message)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
-        exit(1);
-    }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
-        exit(1);
-    }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    UpdateNode msg;
-    msg.ParseFromCodedStream (&codedIn);
-    return msg;
+    return message.port_number();
 }
 
-RemoveNode ClientServerChannel::readRemoveNode(void) {
+int64_t ClientServerChannel::readTimeMessage() {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    if (!readMessage(timeMessage)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
+    return timeMessage.time();
+}
+
+const AdvanceTimeSteps& ClientServerChannel::readAdvanceTimeSteps(void) {
+    NS_LOG_FUNCTION(this);
+    if (!readMessage(advanceTimeSteps)) {
         exit(1);
     }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
+    return advanceTimeSteps;
+}
+
+const AddNode& ClientServerChannel::readAddNode(void) {
+    NS_LOG_FUNCTION(this);
+    if (!readMessage(addNode)) {
         exit(1);
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    RemoveNode msg;
-    msg.ParseFromCodedStream (&codedIn);
-    return msg;
+    return addNode;
 }
 
-ConfigureWifiRadio ClientServerChannel::readConfigureWifiRadio(void) {
+const UpdateNode& ClientServerChannel::readUpdateNode(void) {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    if (!readMessage(updateNode)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
+    return updateNode;
+}
+
+const PositionBatch& ClientServerChannel::readUpdateNodePacked(void) {
+    NS_LOG_FUNCTION(this);
+    const char* data;
+    uint32_t size;
+    if ( !readFrame ( data, size ) ) {
         exit(1);
     }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
+    const uint64_t allocations_before = ns3::GetHeapAllocationCount();
+    const bool success = decodeUpdateNodePacked ( data, size, positionBatch );
+    statistics.decodeAllocations += ns3::GetHeapAllocationCount() - allocations_before;
+    if ( !success ) {
         exit(1);
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    ConfigureWifiRadio message;
-    message.ParseFromCodedStream ( &codedIn );
-    return message;
+    return positionBatch;
 }
 
-SendWifiMessage ClientServerChannel::readSendWifiMessage(void) {
+const RemoveNode& ClientServerChannel::readRemoveNode(void) {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    if (!readMessage(removeNode)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
+    return removeNode;
+}
+
+const ConfigureWifiRadio& ClientServerChannel::readConfigureWifiRadio(void) {
+    NS_LOG_FUNCTION(this);
+    if (!readMessage(configureWifiRadio)) {
         exit(1);
     }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
+    return configureWifiRadio;
+}
+
+const SendWifiMessage& ClientServerChannel::readSendWifiMessage(void) {
+    NS_LOG_FUNCTION(this);
+    if (!readMessage(sendWifiMessage)) {
         exit(1);
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
 
-    SendWifiMessage message;
-    message.ParseFromCodedStream(&codedIn);
-
-    if (message.has_topological_address() ) {
+    if (sendWifiMessage.has_topological_address() ) {
         // all good
-    } else if (message.has_rectangle_address() ) {
+    } else if (sendWifiMessage.has_rectangle_address() ) {
         NS_LOG_ERROR("Not yet implemented.");
         exit(1);
-    } else if (message.has_circle_address() ) {
+    } else if (sendWifiMessage.has_circle_address() ) {
         NS_LOG_ERROR("Not yet implemented.");
         exit(1);
     } else {
@@ -437,63 +640,37 @@ SendWifiMessage ClientServerChannel::readSendWifiMessage(void) {
         exit(1);
     }
 
-    return message;
+    return sendWifiMessage;
 }
 
-ConfigureCellRadio ClientServerChannel::readConfigureCellRadio(void) {
+const ConfigureCellRadio& ClientServerChannel::readConfigureCellRadio(void) {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    if (!readMessage(configureCellRadio)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
-        exit(1);
-    }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
-        exit(1);
-    }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
-
-    ConfigureCellRadio message;
-    message.ParseFromCodedStream ( &codedIn );
-    return message;
+    return configureCellRadio;
 }
 
-SendCellMessage ClientServerChannel::readSendCellMessage(void) {
+const SendCellMessage& ClientServerChannel::readSendCellMessage(void) {
     NS_LOG_FUNCTION(this);
-    const std::shared_ptr < uint32_t > message_size = readVarintPrefix(sock);
-    if (!message_size) { 
-        NS_LOG_ERROR("Cannot access message size");
+    if (!readMessage(sendCellMessage)) {
         exit(1);
     }
-    if (*message_size < 0) {
-        NS_LOG_ERROR("Message size smaller zero");
-        exit(1);
-    }
-    char message_buffer[*message_size];
-    const size_t count = recv(sock, message_buffer, *message_size, MSG_WAITALL);
-    if (*message_size != count) {
-        NS_LOG_ERROR("Expected " << *message_size << " bytes, but read " << count << " bytes");
+
+    if (!sendCellMessage.has_topological_address()) {
+        NS_LOG_ERROR("Address is missing.");
         exit(1);
     }
-    google::protobuf::io::ArrayInputStream arrayIn ( message_buffer, *message_size );
-    google::protobuf::io::CodedInputStream codedIn ( &arrayIn );
 
-    SendCellMessage message;
-    message.ParseFromCodedStream(&codedIn);
+    return sendCellMessage;
+}
 
-    if (!message.has_topological_address()) {
-        NS_LOG_ERROR("Address is missing.");
+const CommandBatch& ClientServerChannel::readCommandBatch(void) {
+    NS_LOG_FUNCTION(this);
+    if (!readMessage(commandBatch)) {
         exit(1);
     }
-
-    return message;
+    return commandBatch;
 }
 
 //#####################################################
@@ -502,19 +679,9 @@ SendCellMessage ClientServerChannel::readSendCellMessage(void) {
 
 void ClientServerChannel::writeCommand(CommandMessage_CommandType cmd) {
     NS_LOG_FUNCTION(this << cmd);
-    CommandMessage commandMessage;
+    // readCommand() keeps only the type, so the read instance can be reused
     commandMessage.set_command_type(cmd);
-
-    int varintsize = google::protobuf::io::CodedOutputStream::VarintSize32(commandMessage.ByteSizeLong());
-    int message_size = varintsize + commandMessage.ByteSizeLong();
-
-    char message_buffer[message_size];
-    google::protobuf::io::ArrayOutputStream arrayOut ( message_buffer, message_size );
-    google::protobuf::io::CodedOutputStream codedOut ( &arrayOut );
-    codedOut.WriteVarint32(commandMessage.ByteSizeLong());
-    commandMessage.SerializeToCodedStream(&codedOut);
-
-    const size_t count = send ( sock, message_buffer, message_size, 0 );
+    appendFrame(commandMessage);
 }
 
 void ClientServerChannel::writeReceiveWifiMessage(uint64_t time, int node_id, int message_id, RadioChannel channel, int rssi) {
@@ -525,21 +692,7 @@ void ClientServerChannel::writeReceiveWifiMessage(uint64_t time, int node_id, in
     message.set_message_id(message_id);
     message.set_channel_id(channel);
     message.set_rssi(rssi);
-
-    int varintsize = google::protobuf::io::CodedOutputStream::VarintSize32(message.ByteSizeLong());
-    int message_size = varintsize + message.ByteSizeLong();
-
-    char message_buffer[message_size];
-    google::protobuf::io::ArrayOutputStream arrayOut ( message_buffer, message_size );
-    google::protobuf::io::CodedOutputStream codedOut ( &arrayOut );
-    codedOut.WriteVarint32 ( message.ByteSizeLong() );
-    message.SerializeToCodedStream ( &codedOut );
-
-    const size_t count = send ( sock, message_buffer, message_size, 0 );
-    if (message_size != count) {
-        NS_LOG_ERROR("Expected " << message_size << " bytes, but wrote " << count << " bytes");
-        exit(1);
-    }
+    appendFrame(message);
 }
 
 void ClientServerChannel::writeReceiveCellMessage(uint64_t time, int node_id, int message_id) {
@@ -548,38 +701,105 @@ void ClientServerChannel::writeReceiveCellMessage(uint64_t time, int node_id, in
     message.set_time(time);
     message.set_node_id(node_id);
     message.set_message_id(message_id);
+    appendFrame(message);
+}
 
-    int varintsize = google::protobuf::io::CodedOutputStream::VarintSize32(message.ByteSizeLong());
-    int message_size = varintsize + message.ByteSizeLong();
+void ClientServerChannel::queueReceiveWifiMessage(uint64_t time, int node_id, int message_id, RadioChannel channel) {
+    NS_LOG_FUNCTION(this << time << node_id << message_id << channel);
+    if (receiverGroupsEnabled) {
+        auto it = pendingGroupIndex.find(message_id);
+        if (it == pendingGroupIndex.end()) {
+            if (pendingGroupCount == pendingGroups.size()) {
+                pendingGroups.emplace_back();
+            }
+            PendingReceiverGroup& group = pendingGroups[pendingGroupCount];
+            group.messageId = message_id;
+            group.channel = channel;
+            group.receivers.clear();
+            it = pendingGroupIndex.emplace(message_id, pendingGroupCount++).first;
+        }
+        PendingReceiverGroup& group = pendingGroups[it->second];
+        if (group.channel == channel) {
+            group.receivers.emplace_back(node_id, time);
+            return;
+        }
+        // a reception which does not share the channel with its group is reported individually
+    }
+    wifiReceiveBatch.add_time(time);
+    wifiReceiveBatch.add_node_id(node_id);
+    wifiReceiveBatch.add_message_id(message_id);
+    wifiReceiveBatch.add_channel_id(channel);
+}
 
-    char message_buffer[message_size];
-    google::protobuf::io::ArrayOutputStream arrayOut ( message_buffer, message_size );
-    google::protobuf::io::CodedOutputStream codedOut ( &arrayOut );
-    codedOut.WriteVarint32 ( message.ByteSizeLong() );
-    message.SerializeToCodedStream ( &codedOut );
+void ClientServerChannel::queueReceiveCellMessage(uint64_t time, int node_id, int message_id) {
+    NS_LOG_FUNCTION(this << time << node_id << message_id);
+    cellReceiveBatch.add_time(time);
+    cellReceiveBatch.add_node_id(node_id);
+    cellReceiveBatch.add_message_id(message_id);
+}
 
-    const size_t count = send ( sock, message_buffer, message_size, 0 );
-    if (message_size != count) {
-        NS_LOG_ERROR("Expected " << message_size << " bytes, but wrote " << count << " bytes");
-        exit(1);
+void ClientServerChannel::setReceiverGroupsEnabled(bool enabled) {
+    receiverGroupsEnabled = enabled;
+}
+
+void ClientServerChannel::writeReceiveBatches() {
+    NS_LOG_FUNCTION(this << wifiReceiveBatch.time_size() << pendingGroupCount << cellReceiveBatch.time_size());
+    for (size_t i = 0; i < pendingGroupCount; i++) {
+        PendingReceiverGroup& pending = pendingGroups[i];
+        std::sort(pending.receivers.begin(), pending.receivers.end());
+
+        ReceiverGroup* group = wifiReceiveBatch.add_groups();
+        group->set_message_id(pending.messageId);
+        group->set_channel_id(pending.channel);
+        int64_t baseTime = pending.receivers.front().second;
+        bool sameTime = true;
+        for (const auto& receiver : pending.receivers) {
+            sameTime &= receiver.second == baseTime;
+            baseTime = std::min(baseTime, receiver.second);
+        }
+        group->set_base_time(baseTime);
+        uint32_t previousId = 0;
+        for (const auto& receiver : pending.receivers) {
+            group->add_node_id_delta(receiver.first - previousId);
+            previousId = receiver.first;
+            if (!sameTime) {
+                group->add_time_offset(receiver.second - baseTime);
+            }
+        }
+    }
+    pendingGroupCount = 0;
+    pendingGroupIndex.clear();
+
+    if (wifiReceiveBatch.time_size() > 0 || wifiReceiveBatch.groups_size() > 0) {
+        writeCommand(CommandMessage_CommandType_RECV_WIFI_MSG_BATCH);
+        appendFrame(wifiReceiveBatch);
+        wifiReceiveBatch.Clear();
     }
+    if (cellReceiveBatch.time_size() > 0) {
+        writeCommand(CommandMessage_CommandType_RECV_CELL_MSG_BATCH);
+        appendFrame(cellReceiveBatch);
+        cellReceiveBatch.Clear();
+    }
+}
+
+void ClientServerChannel::writeCommandBatchResult(uint32_t applied, const std::vector < uint32_t >& failed_indices) {
+    NS_LOG_FUNCTION(this << applied << failed_indices.size());
+    CommandBatchResult message;
+    message.set_applied(applied);
+    message.mutable_failed_indices()->Add(failed_indices.begin(), failed_indices.end());
+    appendFrame(message);
+}
+
+void ClientServerChannel::writeInitMessage(const InitMessage& message) {
+    NS_LOG_FUNCTION(this);
+    appendFrame(message);
 }
 
 void ClientServerChannel::writeTimeMessage(int64_t time) {
     NS_LOG_FUNCTION(this << time);
     TimeMessage time_message;
     time_message.set_time ( time );
-
-    int varintsize = google::protobuf::io::CodedOutputStream::VarintSize32 ( time_message.ByteSizeLong() );
-    int message_size = varintsize + time_message.ByteSizeLong();
-
-    char message_buffer[message_size];
-    google::protobuf::io::ArrayOutputStream arrayOut ( message_buffer, message_size );
-    google::protobuf::io::CodedOutputStream codedOut ( &arrayOut);
-    codedOut.WriteVarint32 ( time_message.ByteSizeLong() );
-    time_message.SerializeToCodedStream ( &codedOut );
-
-    const size_t count = send ( sock, message_buffer, message_size, 0 );
+    appendFrame(time_message);
 }
 
 void ClientServerChannel::writePort(uint32_t port) {
@@ -587,51 +807,153 @@ void ClientServerChannel::writePort(uint32_t port) {
     PortExchange port_exchange;
     port_exchange.set_port_number ( port );
     NS_LOG_LOGIC("write port exchange: " << port_exchange.port_number());
+    appendFrame(port_exchange);
+}
 
-    int varintsize = google::protobuf::io::CodedOutputStream::VarintSize32(port_exchange.ByteSizeLong());
-    int message_size = varintsize + port_exchange.ByteSizeLong();
-
-    char message_buffer[message_size];
-    google::protobuf::io::ArrayOutputStream arrayOut ( message_buffer, message_size );
-    google::protobuf::io::CodedOutputStream codedOut ( &arrayOut);
-    codedOut.WriteVarint32(port_exchange.ByteSizeLong());
-    port_exchange.SerializeToCodedStream(&codedOut);
-
-    const size_t count = send ( sock, message_buffer, message_size, 0 );
-    if (message_size != count) {
-        NS_LOG_ERROR("Expected " << message_size << " bytes, but wrote " << count << " bytes");
-        exit(1);
+void ClientServerChannel::flush() {
+    NS_LOG_FUNCTION(this << sendBuffer.size());
+    if ( sharedMemory ) {
+        if ( !sendBuffer.empty() ) {
+            statistics.sendCalls++;
+            if ( !sharedMemory->send ( sendBuffer.data(), sendBuffer.size() ) ) {
+                NS_LOG_ERROR("Expected to write " << sendBuffer.size() << " bytes, but shared memory segment " << sharedMemory->getName() << " was closed by the peer");
+                exit(1);
+            }
+            statistics.sendBytes += sendBuffer.size();
+        }
+        sendBuffer.clear();
+        return;
+    }
+    size_t offset = 0;
+    while ( offset < sendBuffer.size() ) {
+        const ssize_t count = send ( sock, sendBuffer.data() + offset, sendBuffer.size() - offset, 0 );
+        statistics.sendCalls++;
+        if ( count < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            NS_LOG_ERROR("Expected to write " << sendBuffer.size() << " bytes, but failed after " << offset << " bytes: " << strerror(errno));
+            exit(1);
+        }
+        statistics.sendBytes += count;
+        offset += count;
     }
+    sendBuffer.clear(); // keeps the capacity for the next frames
 }
 
 //#####################################################
 //  Private helpers
 //#####################################################
 
-std::shared_ptr < uint32_t > ClientServerChannel::readVarintPrefix(SOCKET sock) {
-    NS_LOG_FUNCTION(this << sock);
+bool ClientServerChannel::readVarintPrefix(uint32_t& value) {
+    NS_LOG_FUNCTION(this);
     int num_bytes=0;
     char current_byte;
 
-    //first receive one byte from the channel
-    const size_t count = recv ( sock, &current_byte, 1, 0 );
-
-    num_bytes++;
-    if(count<0) {   //If we could not read one byte, return error
-        return std::shared_ptr < uint32_t> ();
+    //first take one byte from the stream
+    if ( !readBytes ( &current_byte, 1 ) ) {   //If we could not read one byte, return error
+        return false;
     }
-    int return_value = ( current_byte & 0x7f );   //We get effectively 7 bits per byte
+    num_bytes++;
+    uint32_t return_value = ( current_byte & 0x7f );   //We get effectively 7 bits per byte
     while ( current_byte & 0x80 ) { //as long as the msb is set, there comes another byte
         current_byte = 0;
-        const size_t count = recv ( sock, &current_byte, 1, 0 );  //receive another byte
+        const bool success = readBytes ( &current_byte, 1 );  //take another byte
         num_bytes++;
-        if ( count < 0 || num_bytes > 4) {          //If we have too many bytes or reading failed return error
-            return std::shared_ptr < uint32_t>();
+        if ( !success || num_bytes > 4) {          //If we have too many bytes or reading failed return error
+            return false;
         }
         return_value |= ( current_byte & 0x7F ) << ( 7 * (num_bytes - 1 ) );    //Add the next 7 bits
-        }
+    }
     NS_LOG_LOGIC("readVarintPrefix return value: " << return_value);
-    return std::make_shared < uint32_t > ( return_value );
+    value = return_value;
+    return true;
+}
+
+bool ClientServerChannel::readBytes(char* destination, size_t size) {
+    while ( size > 0 ) {
+        if ( recvBegin == recvEnd && !fillReceiveBuffer() ) {
+            return false;
+        }
+        const size_t chunk = std::min ( size, recvEnd - recvBegin );
+        memcpy ( destination, recvBuffer.data() + recvBegin, chunk );
+        recvBegin += chunk;
+        destination += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+bool ClientServerChannel::bufferFrame(size_t size) {
+    if ( recvBuffer.size() - recvBegin < size ) {
+        // the frame does not fit behind the read position: move the unread rest to the front,
+        // and grow the buffer if this is the largest frame seen so far
+        memmove ( recvBuffer.data(), recvBuffer.data() + recvBegin, recvEnd - recvBegin );
+        recvEnd -= recvBegin;
+        recvBegin = 0;
+        if ( recvBuffer.size() < size ) {
+            NS_LOG_LOGIC("grow receive buffer from " << recvBuffer.size() << " to " << size << " bytes");
+            recvBuffer.resize ( size );
+        }
+    }
+    while ( recvEnd - recvBegin < size ) {
+        if ( !fillReceiveBuffer() ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ClientServerChannel::fillReceiveBuffer() {
+    if ( recvBegin == recvEnd ) {
+        // everything consumed, start over at the front of the buffer
+        recvBegin = 0;
+        recvEnd = 0;
+    } else if ( recvEnd == recvBuffer.size() ) {
+        // move the unread rest to the front to make room for new bytes
+        memmove ( recvBuffer.data(), recvBuffer.data() + recvBegin, recvEnd - recvBegin );
+        recvEnd -= recvBegin;
+        recvBegin = 0;
+    }
+    ssize_t count;
+    if ( sharedMemory ) {
+        count = sharedMemory->receive ( recvBuffer.data() + recvEnd, recvBuffer.size() - recvEnd );
+        statistics.recvCalls++;
+        if ( count == 0 ) {
+            NS_LOG_ERROR("shared memory segment " << sharedMemory->getName() << " was closed by the peer");
+            return false;
+        }
+    } else {
+        do {
+            // without MSG_WAITALL, recv() returns as soon as any bytes are available, up to the free space
+            count = recv ( sock, recvBuffer.data() + recvEnd, recvBuffer.size() - recvEnd, 0 );
+        } while ( count < 0 && errno == EINTR );
+        statistics.recvCalls++;
+        if ( count <= 0 ) {
+            NS_LOG_ERROR("recv on socket " << sock << " failed (" << count << "): " << strerror(errno));
+            return false;
+        }
+    }
+    statistics.recvBytes += count;
+    recvEnd += count;
+    NS_LOG_LOGIC("fillReceiveBuffer received " << count << " bytes, buffered " << (recvEnd - recvBegin) << " bytes");
+    return true;
+}
+
+void ClientServerChannel::appendFrame(const google::protobuf::MessageLite& message) {
+    const size_t message_size = message.ByteSizeLong();
+    const size_t varint_size = google::protobuf::io::CodedOutputStream::VarintSize32 ( message_size );
+    const size_t offset = sendBuffer.size();
+    sendBuffer.resize ( offset + varint_size + message_size );
+
+    uint8_t* target = reinterpret_cast < uint8_t* > ( sendBuffer.data() + offset );
+    target = google::protobuf::io::CodedOutputStream::WriteVarint32ToArray ( message_size, target );
+    message.SerializeWithCachedSizesToArray ( target );
+    statistics.framesWritten++;
+}
+
+const ChannelStatistics& ClientServerChannel::getStatistics() const {
+    return statistics;
 }
 
 } // namespace ClientServerChannelSpace
@@ -25,19 +25,65 @@
 
 #undef NaN
 #include "ClientServerChannelMessages.pb.h"
+#include "shared-memory-transport.h"
 
-#include <memory> // shared_ptr
+#include <memory>
+#include <unordered_map>
+#include <vector>
 
 typedef int SOCKET;
 constexpr const int SOCKET_ERROR = -1;
 constexpr const int INVALID_SOCKET = -1;
-constexpr const int PROTOCOL_VERSION = 3;
+constexpr const int PROTOCOL_VERSION = 4;
+/** oldest protocol version of the ambassador which is still accepted */
+constexpr const int MIN_PROTOCOL_VERSION = 3;
+/** protocol version which introduced COMMAND_BATCH */
+constexpr const int COMMAND_BATCH_PROTOCOL_VERSION = 4;
+/** protocol version which introduced ADVANCE_TIME_STEPS */
+constexpr const int ADVANCE_TIME_STEPS_PROTOCOL_VERSION = 4;
 
 /**
  * Abstraction of socket communication between Ambassador and Federate (e.g. ns-3 or OMNeT++).
  */
 namespace ClientServerChannelSpace {
 
+/**
+ * Counters about the socket usage of a channel, e.g. to derive the average number of bytes per syscall.
+ */
+struct ChannelStatistics {
+	/** number of recv() syscalls issued on the working socket (or reads from the shared memory ring) */
+	uint64_t recvCalls = 0;
+	/** number of bytes received with these syscalls */
+	uint64_t recvBytes = 0;
+	/** number of frames (length prefix plus message) decoded */
+	uint64_t framesRead = 0;
+	/** number of heap allocations while decoding frames, only counted when built with --count-allocations */
+	uint64_t decodeAllocations = 0;
+	/** number of send() syscalls issued on the working socket (or writes to the shared memory ring) */
+	uint64_t sendCalls = 0;
+	/** number of bytes sent with these syscalls */
+	uint64_t sendBytes = 0;
+	/** number of frames (length prefix plus message) queued for sending */
+	uint64_t framesWritten = 0;
+};
+
+/**
+ * Positions of many nodes at one point in time, decoded from an UpdateNodePacked message.
+ * ids[i] is located at positions[i], the positions are stored contiguously and already dequantized.
+ * velocities is either empty or holds the velocity of each node in m/s, NaN if unknown for a node.
+ */
+struct PositionBatch {
+	struct Position {
+		double x;
+		double y;
+		double z;
+	};
+	int64_t time = 0;
+	std::vector < uint32_t > ids;
+	std::vector < Position > positions;
+	std::vector < Position > velocities;
+};
+
 class ClientServerChannel {
 
 	public:
@@ -62,12 +108,50 @@ class ClientServerChannel {
 		 */
 		int	prepareConnection(std::string host, uint32_t port);
 
+		/**
+		 * Provides server socket to listen for incoming connections from ns3 Ambassador on a unix domain socket.
+		 * Used instead of prepareConnection, if Ambassador and Federate run on the same host. An existing file at
+		 * the given path is replaced, the socket file is removed again when the channel is destroyed.
+		 *
+		 * @param path file system path of the socket
+		 */
+		void prepareUnixConnection(std::string path);
+
 		/**
 		 * @brief Accepts a connection (blocking)
 		 * The resulting connection is stored in the working socket
 		 */
 		void connect();
 
+		/**
+		 * @brief Connects the working socket to a listening channel instead of accepting a connection
+		 *
+		 * Used by stand-ins of the ambassador, e.g. the benchmark drivers and tools/shm-peer.cc.
+		 *
+		 * @param host hostname (hostaddress) of the listening channel
+		 * @param port port of the listening channel
+		 * @return false, if nobody listens on the port (yet)
+		 */
+		bool connectTo(std::string host, uint32_t port);
+
+		/**
+		 * @brief Connects the working socket to a channel listening on a unix domain socket
+		 *
+		 * @param path file system path of the socket
+		 * @return false, if nobody listens on the path (yet)
+		 */
+		bool connectToUnix(std::string path);
+
+		/**
+		 * @brief Replaces the working socket by the given shared memory transport for all further reads and writes
+		 *
+		 * Must only be called at a sync point, i.e. when no bytes are buffered in either direction.
+		 * The socket stays connected but is not used anymore.
+		 *
+		 * @param transport the transport whose segment has been attached by the ambassador
+		 */
+		void switchToSharedMemory(std::unique_ptr < SharedMemoryTransport > transport);
+
 		/*################## READING ####################*/
 
 		/**
@@ -85,6 +169,13 @@ class ClientServerChannel {
 		 */
 		InitMessage readInitMessage();
 
+		/**
+		 * Reads a PortExchange message from the channel, the counterpart of writePort()
+		 *
+		 * @return the port number
+		 */
+		uint32_t readPort();
+
 		/**
 		 * Reads a TimeMessage from the channel
 		 *
@@ -92,56 +183,83 @@ class ClientServerChannel {
 		 */
 		int64_t readTimeMessage();
 
+		/**
+		 * Reads an AdvanceTimeSteps message from the channel
+		 *
+		 * @return AdvanceTimeSteps message, owned by the channel and valid until the next read of this type
+		 */
+		const AdvanceTimeSteps& readAdvanceTimeSteps(void);
+
 		/**
 		 * Reads an AddNode message from the channel.
 		 *
-		 * @return AddNode message
+		 * @return AddNode message, owned by the channel and valid until the next read of this type
 		 */
-		AddNode readAddNode(void);
+		const AddNode& readAddNode(void);
 
 		/**
 		 * Reads an update Node message from the channel.
 		 *
-		 * @return UpdateNode message
+		 * @return UpdateNode message, owned by the channel and valid until the next read of this type
+		 */
+		const UpdateNode& readUpdateNode(void);
+
+		/**
+		 * Reads an UpdateNodePacked message from the channel. The message is decoded directly into
+		 * the id and position arrays of the batch, without materializing the protobuf message.
+		 *
+		 * @return decoded positions, owned by the channel and valid until the next read of this type
 		 */
-		UpdateNode readUpdateNode(void);
+		const PositionBatch& readUpdateNodePacked(void);
 
 		/**
 		 * Reads an RemoveNode message from the channel.
 		 *
-		 * @return RemoveNode message
+		 * @return RemoveNode message, owned by the channel and valid until the next read of this type
 		 */
-		RemoveNode readRemoveNode(void);
+		const RemoveNode& readRemoveNode(void);
 		
 		/**
 		 * Reads a ConfigureWifiRadio message from the channel
 		 *
-		 * @return ConfigureWifiRadio message
+		 * @return ConfigureWifiRadio message, owned by the channel and valid until the next read of this type
 		 */
-		ConfigureWifiRadio readConfigureWifiRadio(void);
+		const ConfigureWifiRadio& readConfigureWifiRadio(void);
 
 		/**
 		 * Reads a SendWifiMessage message from the channel
 		 *
-		 * @return SendWifiMessage message
+		 * @return SendWifiMessage message, owned by the channel and valid until the next read of this type
 		 */
-		SendWifiMessage readSendWifiMessage(void);
+		const SendWifiMessage& readSendWifiMessage(void);
 
 		/**
 		 * Reads a ConfigureCellRadio message from the channel
 		 *
-		 * @return ConfigureCellRadio message
+		 * @return ConfigureCellRadio message, owned by the channel and valid until the next read of this type
 		 */
-		ConfigureCellRadio readConfigureCellRadio(void);
+		const ConfigureCellRadio& readConfigureCellRadio(void);
 
 		/**
 		 * Reads a SendCellMessage message from the channel
 		 *
-		 * @return SendCellMessage message
+		 * @return SendCellMessage message, owned by the channel and valid until the next read of this type
 		 */
-		SendCellMessage readSendCellMessage(void);
+		const SendCellMessage& readSendCellMessage(void);
+
+		/**
+		 * Reads a CommandBatch message from the channel
+		 *
+		 * @return CommandBatch message, owned by the channel and valid until the next read of this type
+		 */
+		const CommandBatch& readCommandBatch(void);
 
 		/*################## WRITING ####################*/
+		/*
+		 * All write methods only append their frame to the output buffer of the channel.
+		 * Nothing is sent before flush() is called, which has to be done at every protocol
+		 * sync point, i.e. whenever the ambassador is waiting for an answer.
+		 */
 
 		/**
 		 * Sends own control commands to ambassador
@@ -158,6 +276,13 @@ class ClientServerChannel {
 		 */
 		void writePort(uint32_t port);
 
+		/**
+		 * Writes an InitMessage onto the channel, the counterpart of readInitMessage()
+		 *
+		 * @param message the message to write
+		 */
+		void writeInitMessage(const InitMessage& message);
+
 		/**
 		 * Writes a time onto the channel and thereby request a time advance from the RTI
 		 *
@@ -185,6 +310,58 @@ class ClientServerChannel {
 		 */
 		void writeReceiveCellMessage(uint64_t time, int node_id, int message_id);
 
+		/**
+		 * Adds a wifi reception to the pending RECV_WIFI_MSG_BATCH, written by writeReceiveBatches().
+		 *
+		 * @param time the simulation time at which the message receive occured
+		 * @param node_id the id of the receiving node
+		 * @param message_id the id of the received message
+		 * @param channel the receiver channel
+		 */
+		void queueReceiveWifiMessage(uint64_t time, int node_id, int message_id, RadioChannel channel);
+
+		/**
+		 * Adds a cell reception to the pending RECV_CELL_MSG_BATCH, written by writeReceiveBatches().
+		 *
+		 * @param time the simulation time at which the message receive occured
+		 * @param node_id the id of the receiving node
+		 * @param message_id the id of the received message
+		 */
+		void queueReceiveCellMessage(uint64_t time, int node_id, int message_id);
+
+		/**
+		 * Enables grouping of the queued wifi receptions by message id, reported as ReceiverGroup in the next batch.
+		 *
+		 * @param enabled true to group receptions
+		 */
+		void setReceiverGroupsEnabled(bool enabled);
+
+		/**
+		 * Writes the pending receptions as RECV_WIFI_MSG_BATCH and RECV_CELL_MSG_BATCH, each followed
+		 * by a ReceiveBatch message. Nothing is written for an empty batch.
+		 */
+		void writeReceiveBatches();
+
+		/**
+		 * Writes a CommandBatchResult message onto the channel, following the SUCCESS of a COMMAND_BATCH.
+		 *
+		 * @param applied number of entries applied successfully
+		 * @param failed_indices indices of the entries which could not be applied, in ascending order
+		 */
+		void writeCommandBatchResult(uint32_t applied, const std::vector < uint32_t >& failed_indices);
+
+		/**
+		 * Sends all frames written since the last flush with a single send() call (or ring write).
+		 */
+		void flush();
+
+		/**
+		 * Returns the socket usage counters of this channel.
+		 *
+		 * @return statistics of this channel
+		 */
+		const ChannelStatistics& getStatistics() const;
+
 	private:
 		/** Initial server socket
 		 * always on the lookout for new connections on that port
@@ -195,15 +372,126 @@ class ClientServerChannel {
 		/** Working sock for communication. */
 		SOCKET sock;
 
+		/** File system path of the server socket, if a unix domain socket is used, empty otherwise. */
+		std::string socketPath;
+
+		/** Shared memory transport replacing the working socket, if negotiated during INIT. */
+		std::unique_ptr < SharedMemoryTransport > sharedMemory;
+
 		/**
-		 * @brief Reads a variable length integer from the socket and returns it
+		 * Receive buffer of the working socket. All read methods consume from this buffer,
+		 * which is refilled with as many bytes as the socket has available in one recv() call.
+		 * Unread bytes are in the range [recvBegin, recvEnd).
+		 */
+		std::vector < char > recvBuffer;
+		size_t recvBegin;
+		size_t recvEnd;
+
+		/** Output buffer holding the serialized frames until the next flush(). */
+		std::vector < char > sendBuffer;
+
+		ChannelStatistics statistics;
+
+		/**
+		 * Message instances reused for every read of their type. Clearing and re-parsing a message keeps
+		 * the memory of its repeated fields, so decoding is free of heap allocations in the steady state.
+		 */
+		CommandMessage commandMessage;
+		TimeMessage timeMessage;
+		AdvanceTimeSteps advanceTimeSteps;
+		AddNode addNode;
+		UpdateNode updateNode;
+		RemoveNode removeNode;
+		ConfigureWifiRadio configureWifiRadio;
+		SendWifiMessage sendWifiMessage;
+		ConfigureCellRadio configureCellRadio;
+		SendCellMessage sendCellMessage;
+		CommandBatch commandBatch;
+		PositionBatch positionBatch;
+
+		/** Receptions queued until the next writeReceiveBatches(), reused to keep the memory of the packed fields. */
+		ReceiveBatch wifiReceiveBatch;
+		ReceiveBatch cellReceiveBatch;
+
+		/** Wifi receptions of one message id, converted into a ReceiverGroup by writeReceiveBatches(). */
+		struct PendingReceiverGroup {
+			uint32_t messageId;
+			RadioChannel channel;
+			/** pairs of node id and receive time */
+			std::vector < std::pair < uint32_t, int64_t > > receivers;
+		};
+		bool receiverGroupsEnabled = false;
+		/** the first pendingGroupCount entries are in use, the others are kept for their memory */
+		std::vector < PendingReceiverGroup > pendingGroups;
+		size_t pendingGroupCount = 0;
+		/** index into pendingGroups by message id */
+		std::unordered_map < uint32_t, size_t > pendingGroupIndex;
+
+		/**
+		 * @brief Reads a variable length integer from the receive buffer and returns it
 		 *
 		 * Protobuf messages are not self delimiting and have thus to be prefixed with the length of the message.
 		 * When sent from Java, before every message there will be a variable length integer sent.
 		 * This method reads such an integer of variable length
 		 *
+		 * @param value the decoded integer
+		 * @return false, if the integer could not be read or is too long
+		 */
+		bool readVarintPrefix(uint32_t& value);
+
+		/**
+		 * @brief Copies the next bytes of the stream into the given buffer, refilling the receive buffer if necessary
+		 *
+		 * @param destination buffer to copy the bytes to
+		 * @param size number of bytes to read
+		 * @return false, if the connection failed before all bytes could be read
+		 */
+		bool readBytes(char* destination, size_t size);
+
+		/**
+		 * @brief Makes sure that the next frame is completely and contiguously available in the receive buffer
+		 *
+		 * The receive buffer grows to the size of the largest frame seen so far.
+		 *
+		 * @param size size of the frame in bytes
+		 * @return false, if the connection failed before the frame was received completely
+		 */
+		bool bufferFrame(size_t size);
+
+		/**
+		 * @brief Makes the next length prefixed frame available in the receive buffer and consumes it
+		 *
+		 * @param data set to the start of the frame, valid until the next read from the channel
+		 * @param size set to the size of the frame
+		 * @return false, if the frame could not be read
+		 */
+		bool readFrame(const char*& data, uint32_t& size);
+
+		/**
+		 * @brief Reads the next length prefixed message from the channel
+		 *
+		 * The message is parsed in place from the receive buffer.
+		 *
+		 * @param message the message to parse into
+		 * @return false, if the message could not be read or parsed
+		 */
+		template < typename T >
+		bool readMessage(T& message);
+
+		/**
+		 * @brief Issues a single recv() on the working socket (or read from the shared memory ring)
+		 * to append all available bytes to the receive buffer
+		 *
+		 * @return false, if the connection was closed or failed
+		 */
+		bool fillReceiveBuffer();
+
+		/**
+		 * @brief Serializes the message with its varint length prefix into the output buffer
+		 *
+		 * @param message the message to append
 		 */
-		std::shared_ptr < uint32_t > readVarintPrefix(SOCKET sock);
+		void appendFrame(const google::protobuf::MessageLite& message);
 };
 
 } // namespace ClientServerChannelSpace
@@ -32,6 +32,10 @@
 #include "ns3/config-store.h"
 
 #include "mosaic-ns3-bridge.h"
+#include "mosaic-calendar-scheduler.h"
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+#include "mosaic-wifi-channel.h"
+#endif
 
 using namespace ns3;
 
@@ -149,16 +153,25 @@ int main(int argc, char *argv[]) {
     //default values
     int port = 0;
     int cmdPort = 0;
+    std::string socketPath = "";
+    std::string sharedMemory = "";
     std::string configFile = "ns3_federate_config.xml";
 
     MosaicNodeManager::GetTypeId();
+    MosaicCalendarScheduler::GetTypeId();
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+    MosaicWifiChannel::GetTypeId();
+#endif
     CommandLine cmd("ns3-federate");
     cmd.Usage("Mosaic ns-3 federate.");
     cmd.AddValue("cmdPort", "the command port", cmdPort);
     cmd.AddValue("port", "the port", port);
+    cmd.AddValue("socketPath", "use unix domain sockets at this path instead of TCP ports (for co-located MOSAIC)", socketPath);
+    cmd.AddValue("sharedMemory", "offer shared memory ring buffers with this name (e.g. /mosaic-ns3) after the handshake (for co-located MOSAIC)", sharedMemory);
     cmd.AddValue("configFile", "the configuration file", configFile);
     cmd.Parse(argc, argv);
 
+    // default only, can be replaced by <global name="SchedulerType"> in the configuration file
     GlobalValue::Bind("SchedulerType", StringValue("ns3::ListScheduler"));
     GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::MosaicSimulatorImpl"));
     if (access(configFile.c_str(), F_OK) == -1) {
@@ -176,7 +189,7 @@ int main(int argc, char *argv[]) {
     Time::SetResolution (Time::NS);
 
     try {
-        MosaicNs3Bridge instance(port, cmdPort);
+        MosaicNs3Bridge instance(port, cmdPort, socketPath, sharedMemory);
         instance.run();
     } catch (int e) {
         NS_LOG_ERROR("Caught exception [" << e << "]. Exiting ns-3 federate ");
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mosaic-calendar-scheduler.h"
+
+#include <algorithm>
+
+#include "ns3/event-impl.h"
+#include "ns3/uinteger.h"
+#include "ns3/log.h"
+
+NS_LOG_COMPONENT_DEFINE("MosaicCalendarScheduler");
+
+namespace ns3 {
+
+    NS_OBJECT_ENSURE_REGISTERED(MosaicCalendarScheduler);
+
+    TypeId MosaicCalendarScheduler::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::MosaicCalendarScheduler")
+                .SetParent<Scheduler>()
+                .AddConstructor<MosaicCalendarScheduler>()
+                .AddAttribute("BucketWidth", "Time span covered by one bucket",
+                TimeValue(MilliSeconds(1)),
+                MakeTimeAccessor(&MosaicCalendarScheduler::m_bucketWidthAttribute),
+                MakeTimeChecker(TimeStep(1)))
+                .AddAttribute("NumBuckets", "Number of buckets, rounded up to a power of two",
+                UintegerValue(1024),
+                MakeUintegerAccessor(&MosaicCalendarScheduler::m_numBuckets),
+                MakeUintegerChecker<uint32_t> (1, 1u << 24))
+                ;
+        return tid;
+    }
+
+    MosaicCalendarScheduler::MosaicCalendarScheduler()
+      : m_numBuckets(0),
+        m_bucketWidth(0),
+        m_mask(0),
+        m_size(0),
+        m_cursor(0) {
+    }
+
+    void MosaicCalendarScheduler::Initialize(void) {
+        uint64_t numBuckets = 1;
+        while (numBuckets < m_numBuckets) {
+            numBuckets <<= 1;
+        }
+        m_mask = numBuckets - 1;
+        m_bucketWidth = std::max<int64_t>(m_bucketWidthAttribute.GetTimeStep(), 1);
+        m_buckets.resize(numBuckets);
+        NS_LOG_INFO("Use " << numBuckets << " buckets of " << m_bucketWidth << " time steps");
+    }
+
+    void MosaicCalendarScheduler::Insert(const Event &ev) {
+        if (m_buckets.empty()) {
+            Initialize();
+        }
+        const uint64_t absolute = ev.key.m_ts / m_bucketWidth;
+        Bucket &bucket = m_buckets[absolute & m_mask];
+        if (bucket.head == bucket.events.size() || bucket.events.back().key < ev.key) {
+            // the usual case: later than everything else in the slot
+            bucket.events.push_back(ev);
+        } else {
+            auto position = std::upper_bound(bucket.events.begin() + bucket.head, bucket.events.end(), ev,
+                    [](const Event &a, const Event &b) { return a.key < b.key; });
+            bucket.events.insert(position, ev);
+        }
+        if (m_size == 0 || absolute < m_cursor) {
+            m_cursor = absolute;
+        }
+        m_size++;
+    }
+
+    bool MosaicCalendarScheduler::IsEmpty(void) const {
+        return m_size == 0;
+    }
+
+    uint32_t MosaicCalendarScheduler::FindNext(void) const {
+        NS_ASSERT(m_size > 0);
+        // scan one round of the calendar, starting at the cursor
+        for (uint64_t i = 0; i <= m_mask; i++) {
+            const uint64_t absolute = m_cursor + i;
+            const Bucket &bucket = m_buckets[absolute & m_mask];
+            if (bucket.head < bucket.events.size() && bucket.events[bucket.head].key.m_ts / m_bucketWidth == absolute) {
+                m_cursor = absolute;
+                return absolute & m_mask;
+            }
+        }
+        // all pending events are more than one round ahead: search the earliest one directly
+        uint32_t slot = 0;
+        const Event *earliest = nullptr;
+        for (uint32_t j = 0; j <= m_mask; j++) {
+            const Bucket &bucket = m_buckets[j];
+            if (bucket.head < bucket.events.size() && (earliest == nullptr || bucket.events[bucket.head].key < earliest->key)) {
+                earliest = &bucket.events[bucket.head];
+                slot = j;
+            }
+        }
+        m_cursor = earliest->key.m_ts / m_bucketWidth;
+        return slot;
+    }
+
+    Scheduler::Event MosaicCalendarScheduler::PeekNext(void) const {
+        const Bucket &bucket = m_buckets[FindNext()];
+        return bucket.events[bucket.head];
+    }
+
+    Scheduler::Event MosaicCalendarScheduler::RemoveNext(void) {
+        Bucket &bucket = m_buckets[FindNext()];
+        Event ev = bucket.events[bucket.head++];
+        if (bucket.head == bucket.events.size()) {
+            // keep the capacity for the next round
+            bucket.events.clear();
+            bucket.head = 0;
+        }
+        m_size--;
+        return ev;
+    }
+
+    void MosaicCalendarScheduler::Remove(const Event &ev) {
+        Bucket &bucket = m_buckets[(ev.key.m_ts / m_bucketWidth) & m_mask];
+        auto position = std::lower_bound(bucket.events.begin() + bucket.head, bucket.events.end(), ev,
+                [](const Event &a, const Event &b) { return a.key < b.key; });
+        NS_ASSERT(position != bucket.events.end() && position->key.m_uid == ev.key.m_uid);
+        bucket.events.erase(position);
+        if (bucket.head == bucket.events.size()) {
+            bucket.events.clear();
+            bucket.head = 0;
+        }
+        m_size--;
+    }
+
+} // namespace ns3
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef MOSAIC_CALENDAR_SCHEDULER_H
+#define MOSAIC_CALENDAR_SCHEDULER_H
+
+#include <vector>
+
+#include "ns3/scheduler.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+    /**
+     * @class MosaicCalendarScheduler
+     * @brief A calendar queue with a fixed number of buckets, tuned for the dense, periodic events of
+     * LTE (1ms subframes) and many WiFi PHYs. In contrast to the ns-3 ListScheduler, inserting an event
+     * only has to search within its bucket, and in contrast to the ns-3 CalendarScheduler the buckets
+     * are contiguous sorted vectors instead of linked lists.
+     *
+     * An event with timestamp ts belongs to the absolute bucket ts / BucketWidth, which is stored in
+     * slot (ts / BucketWidth) % NumBuckets. Each slot keeps its events in ascending order, consumed
+     * events are skipped by a head index, so that the typical insertion (after all other events of the
+     * slot) and removal (the first event of the slot) do not move any events.
+     */
+    class MosaicCalendarScheduler : public Scheduler {
+    public:
+        static TypeId GetTypeId(void);
+
+        MosaicCalendarScheduler();
+        virtual ~MosaicCalendarScheduler() = default;
+
+        virtual void Insert(const Event &ev);
+        virtual bool IsEmpty(void) const;
+        virtual Event PeekNext(void) const;
+        virtual Event RemoveNext(void);
+        virtual void Remove(const Event &ev);
+
+    private:
+        struct Bucket {
+            // events in ascending order, [head, size) are pending
+            std::vector<Event> events;
+            size_t head = 0;
+        };
+
+        /**
+         * @brief create the buckets, done at the first insert as attributes are only set after the constructor ran
+         */
+        void Initialize(void);
+
+        /**
+         * @brief find the slot of the earliest event and move the cursor to its absolute bucket
+         *
+         * @return the slot index
+         */
+        uint32_t FindNext(void) const;
+
+        // Attributes
+        Time m_bucketWidthAttribute;
+        uint32_t m_numBuckets;
+
+        uint64_t m_bucketWidth;
+        uint64_t m_mask;
+        std::vector<Bucket> m_buckets;
+        uint64_t m_size;
+
+        // absolute bucket number which is a lower bound of the earliest event
+        mutable uint64_t m_cursor;
+    };
+
+} // namespace ns3
+#endif /* MOSAIC_CALENDAR_SCHEDULER_H */
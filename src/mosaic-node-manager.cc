@@ -22,7 +22,11 @@
 
 #include "mosaic-node-manager.h"
 
-#include "ns3/node-list.h"
+#include <cmath>
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
 #include "ns3/wifi-net-device.h"
 #include "ns3/lte-ue-net-device.h"
 #include "ns3/lte-ue-rrc.h"
@@ -31,6 +35,8 @@
 #include "ns3/loopback-net-device.h"
 #include "ns3/csma-net-device.h"
 #include "ns3/point-to-point-net-device.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
 
 #include "mosaic-ns3-bridge.h" 
 #include "mosaic-proxy-app.h"
@@ -41,6 +47,9 @@ namespace ns3 {
     
     NS_OBJECT_ENSURE_REGISTERED(MosaicNodeManager);
 
+    // position of radio nodes waiting in the pool, far outside of any scenario
+    static const Vector PARKING_POSITION(-1e7, -1e7, 0);
+
     TypeId MosaicNodeManager::GetTypeId(void) {
         static TypeId tid = TypeId("ns3::MosaicNodeManager")
                 .SetParent<Object>()
@@ -50,20 +59,50 @@ namespace ns3 {
                 UintegerValue(10),
                 MakeUintegerAccessor(&MosaicNodeManager::m_numExtraRadioNodes),
                 MakeUintegerChecker<uint16_t> ())
+                .AddAttribute("DeadReckoning", "Move radio nodes with their last known velocity between position updates. "
+                "The velocity is taken from the update or derived from the previous one.",
+                BooleanValue(false),
+                MakeBooleanAccessor(&MosaicNodeManager::m_deadReckoning),
+                MakeBooleanChecker())
+                .AddAttribute("PositionEpsilon", "Position updates which move a node by less than this distance in m are dropped, "
+                "with DeadReckoning the distance to the extrapolated position is used. 0 disables the filter.",
+                DoubleValue(0),
+                MakeDoubleAccessor(&MosaicNodeManager::m_positionEpsilon),
+                MakeDoubleChecker<double> (0))
+                .AddAttribute("RadioNodeProfile", "Devices installed on radio nodes which do not request specific radios in ADD_NODE. "
+                "WifiOnly nodes have no LTE device, they are created on demand after simulation start and do not need extra radio nodes.",
+                EnumValue(MosaicNodeManager::RADIO_PROFILE_DUAL),
+                MakeEnumAccessor(&MosaicNodeManager::m_radioNodeProfile),
+                MakeEnumChecker(MosaicNodeManager::RADIO_PROFILE_DUAL, "Dual",
+                                MosaicNodeManager::RADIO_PROFILE_WIFI_ONLY, "WifiOnly",
+                                MosaicNodeManager::RADIO_PROFILE_CELL_ONLY, "CellOnly"))
+                .AddAttribute("LazyLteSetup", "Create LTE and EPC (PGW, SGW, MME) only when the first eNB or LTE capable radio node is added, "
+                "instead of at start up. Without EPC, wired nodes can only reach wired nodes in their own /16 network.",
+                BooleanValue(false),
+                MakeBooleanAccessor(&MosaicNodeManager::m_lazyLteSetup),
+                MakeBooleanChecker())
                 ;
         return tid;
     }
 
     MosaicNodeManager::MosaicNodeManager() 
-      : m_backboneAddressHelper("5.0.0.0", "255.0.0.0"),
+      : m_backboneAddressHelper("5.0.0.0", "255.0.0.0", "0.0.0.2"), // 5.0.0.1 is reserved for the PGW
         m_wifiAddressHelper("6.0.0.0", "255.0.0.0", "0.0.0.2") {
 
         /** Helpers **/
         // Wifi
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+        // ns3::MosaicWifiChannel::MaxRange limits receptions to nearby PHYs, see ns3_federate_config.xml
+        m_wifiChannel = CreateObject<MosaicWifiChannel>();
+        m_wifiChannel->SetPropagationLossModel(CreateObject<FriisPropagationLossModel>());
+        m_wifiChannel->SetPropagationDelayModel(CreateObject<ConstantSpeedPropagationDelayModel>());
+        m_wifiPhyHelper.SetChannel(m_wifiChannel);
+#else
         m_wifiChannelHelper.AddPropagationLoss("ns3::FriisPropagationLossModel");
         m_wifiChannelHelper.SetPropagationDelay("ns3::ConstantSpeedPropagationDelayModel");
         Ptr<YansWifiChannel> channel = m_wifiChannelHelper.Create();
         m_wifiPhyHelper.SetChannel(channel);
+#endif
         // ns3::WifiPhy::ChannelWidth|ChannelNumber|Frequency are set via ns3_federate_config.xml
         m_wifiMacHelper.SetType ("ns3::AdhocWifiMac", "QosSupported", BooleanValue (true));
         m_wifiHelper.SetStandard (WIFI_STANDARD_80211p);
@@ -72,12 +111,7 @@ namespace ns3 {
                                 "ControlMode", StringValue ("OfdmRate6MbpsBW10MHz"),
                                 "NonUnicastMode", StringValue ("OfdmRate6MbpsBW10MHz"));
 
-        // LTE
-        m_lteHelper = CreateObject<LteHelper> ();
-        // This EpcHelper creates point-to-point links between the eNBs and the EPCore (3 nodes)
-        m_epcHelper = CreateObject<PointToPointEpcHelper> (); 
-        m_lteHelper->SetEpcHelper (m_epcHelper);
-        m_lteHelper->Initialize ();
+        // LTE helpers are created by SetupLte
         // Wired
         m_csmaHelper.SetChannelAttribute("DataRate", StringValue("100Gb/s"));
         m_csmaHelper.SetChannelAttribute("Delay", TimeValue(NanoSeconds(6560)));
@@ -86,18 +120,36 @@ namespace ns3 {
         // m_lteHelper->EnableLogComponents();
     }
 
+    MosaicNodeManager::~MosaicNodeManager() = default;
+
     void MosaicNodeManager::Configure(MosaicNs3Bridge* serverPtr) {
         NS_LOG_INFO("Initialize Node Infrastructure...");
         m_serverPtr = serverPtr;
 
+        if (!m_lazyLteSetup) {
+            SetupLte();
+        }
+    }
+
+    void MosaicNodeManager::SetupLte() {
+        if (m_lteHelper != nullptr) {
+            return;
+        }
+
         NS_LOG_INFO("Setup core...");
+        m_lteHelper = CreateObject<LteHelper> ();
+        // This EpcHelper creates point-to-point links between the eNBs and the EPCore (3 nodes)
+        m_epcHelper = CreateObject<PointToPointEpcHelper> (); 
+        m_lteHelper->SetEpcHelper (m_epcHelper);
+        m_lteHelper->Initialize ();
+
         Ptr<Node> pgw = m_epcHelper->GetPgwNode ();
         Ptr<Node> sgw = m_epcHelper->GetSgwNode ();
 
         NS_LOG_INFO("Setup backbone connection...");
-        m_backboneNodes.Add (pgw);
-        m_backboneDevices = m_csmaHelper.Install(m_backboneNodes);
-        m_backboneAddressHelper.Assign (m_backboneDevices);
+        Ptr<NetDevice> pgwDevice = InstallBackboneDevice(pgw);
+        Ipv4AddressHelper pgwAddressHelper("5.0.0.0", "255.0.0.0", "0.0.0.1");
+        pgwAddressHelper.Assign (NetDeviceContainer(pgwDevice));
 
         NS_LOG_INFO("Configure routing...");
         // add routing for PGW
@@ -141,7 +193,9 @@ namespace ns3 {
     void MosaicNodeManager::OnStart() {
         NS_LOG_INFO ("Do the final configuration...");
 
-        m_lteHelper->AddX2Interface (m_enbNodes); // required for handover capabilities
+        if (m_lteHelper != nullptr) {
+            m_lteHelper->AddX2Interface (m_enbNodes); // required for handover capabilities
+        }
 
         // NS_LOG_INFO("Schedule manual handovers...");
         // m_lteHelper->HandoverRequest (Seconds (3.000), lteDevices.Get (1), m_enbDevices.Get (0), m_enbDevices.Get (1));
@@ -151,10 +205,18 @@ namespace ns3 {
          * see "Cannot create UE devices after simulation started" at https://gitlab.com/nsnam/ns-3-dev/-/blob/master/src/lte/model/lte-ue-phy.cc#L144
          */ 
         NS_LOG_INFO("Setup extra radioNode's...");
-        for (uint32_t i = 0; i < m_numExtraRadioNodes; i++ ){
-            Ptr<Node> node = CreateRadioNodeHelper();
+        // extra radio nodes are only needed for LTE, they are skipped if radio nodes are Wifi-only by default
+        if (m_radioNodeProfile != RADIO_PROFILE_WIFI_ONLY && m_numExtraRadioNodes > 0) {
+            SetupLte();
+        }
+        for (uint32_t i = 0; m_radioNodeProfile != RADIO_PROFILE_WIFI_ONLY && i < m_numExtraRadioNodes; i++ ){
+            Ptr<Node> node = CreateRadioNodeHelper(RADIO_PROFILE_DUAL);
             m_extraRadioNodes.Add (node);
         }
+        // the first extra node is handed out first
+        for (uint32_t i = m_extraRadioNodes.GetN(); i > 0; i--) {
+            m_freeRadioNodes.push_back(m_extraRadioNodes.Get(i - 1)->GetId());
+        }
 
         PrintNodeConfigs(m_enbNodes, 10);
         PrintNodeConfigs(m_backboneNodes, 10);
@@ -167,6 +229,9 @@ namespace ns3 {
 
         NS_LOG_DEBUG("Print IP assignment for all radioNodes");
         PrintNodeConfigs(m_radioNodes);
+        NS_LOG_INFO("m_countSkippedPositionUpdates=" << m_countSkippedPositionUpdates);
+        NS_LOG_INFO("m_countRecycledRadioNodes=" << m_countRecycledRadioNodes);
+        NS_LOG_INFO("m_countReceivedMessages=" << m_countReceivedMessages);
     }
 
     void MosaicNodeManager::PrintNodeConfigsDeviceAgnostic(NodeContainer nodes, uint32_t maxNum) {
@@ -283,37 +348,61 @@ namespace ns3 {
         }
     }
 
+    MosaicNodeManager::NodeRecord& MosaicNodeManager::GetNodeRecord(uint32_t nodeId) {
+        if (nodeId >= m_nodes.size()) {
+            m_nodes.resize(nodeId + 1);
+        }
+        return m_nodes[nodeId];
+    }
+
+    void MosaicNodeManager::MapNodeId(uint32_t mosaicNodeId, uint32_t nodeId) {
+        if (mosaicNodeId >= m_mosaic2nsdrei.size()) {
+            m_mosaic2nsdrei.resize(mosaicNodeId + 1, INVALID_NODE_ID);
+        }
+        m_mosaic2nsdrei[mosaicNodeId] = nodeId;
+        GetNodeRecord(nodeId).mosaicNodeId = mosaicNodeId;
+    }
+
+    bool MosaicNodeManager::IsMapped(uint32_t mosaicNodeId) const {
+        return mosaicNodeId < m_mosaic2nsdrei.size() && m_mosaic2nsdrei[mosaicNodeId] != INVALID_NODE_ID;
+    }
+
+    bool MosaicNodeManager::IsActive(uint32_t nodeId) const {
+        return nodeId != REMOVED_NODE_ID && !m_nodes[nodeId].Is(NodeRecord::DEACTIVATED);
+    }
+
     uint32_t MosaicNodeManager::GetNs3NodeId(uint32_t mosaicNodeId) {
-        if (m_mosaic2nsdrei.find(mosaicNodeId) == m_mosaic2nsdrei.end()){
+        if (!IsMapped(mosaicNodeId)) {
             NS_LOG_ERROR("Node ID " << mosaicNodeId << " not found in m_mosaic2nsdrei");
-            NS_LOG_INFO("Have m_mosaic2nsdrei");
-            for(const auto& elem : m_mosaic2nsdrei)
-            {
-               NS_LOG_INFO(elem.first << "->" << elem.second);
-            }
-            NS_LOG_INFO("END m_mosaic2nsdrei");
+            LogNodeIds();
             exit(1);
-        } 
-        uint32_t res = m_mosaic2nsdrei[mosaicNodeId];
-        return res;
+        }
+        return m_mosaic2nsdrei[mosaicNodeId];
     }
 
     uint32_t MosaicNodeManager::GetMosaicNodeId(uint32_t ns3NodeId) {
-        if (m_nsdrei2mosaic.find(ns3NodeId) == m_nsdrei2mosaic.end()){
-            NS_LOG_ERROR("Node ID " << ns3NodeId << " not found in m_nsdrei2mosaic");
-            NS_LOG_INFO("Have m_nsdrei2mosaic");
-            for(const auto& elem : m_nsdrei2mosaic)
-            {
-               NS_LOG_INFO(elem.first << "<-" << elem.second);
-            }
-            NS_LOG_INFO("END m_nsdrei2mosaic");
+        if (ns3NodeId >= m_nodes.size() || m_nodes[ns3NodeId].mosaicNodeId == INVALID_NODE_ID) {
+            NS_LOG_ERROR("Node ID " << ns3NodeId << " not found in m_nodes");
+            LogNodeIds();
             exit(1);
-        } 
-        uint32_t res = m_nsdrei2mosaic[ns3NodeId];
-        return res;
+        }
+        return m_nodes[ns3NodeId].mosaicNodeId;
+    }
+
+    void MosaicNodeManager::LogNodeIds() {
+        NS_LOG_INFO("Have m_mosaic2nsdrei");
+        for (uint32_t mosaicNodeId = 0; mosaicNodeId < m_mosaic2nsdrei.size(); mosaicNodeId++) {
+            if (m_mosaic2nsdrei[mosaicNodeId] == REMOVED_NODE_ID) {
+                NS_LOG_INFO(mosaicNodeId << "->removed");
+            } else if (m_mosaic2nsdrei[mosaicNodeId] != INVALID_NODE_ID) {
+                NS_LOG_INFO(mosaicNodeId << "->" << m_mosaic2nsdrei[mosaicNodeId]);
+            }
+        }
+        NS_LOG_INFO("END m_mosaic2nsdrei");
     }
 
     void MosaicNodeManager::CreateNodeB(Vector position) {
+        SetupLte();
         Ptr<Node> node = CreateObject<Node>();
         m_enbNodes.Add (node);
         m_mobilityHelper.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
@@ -327,8 +416,22 @@ namespace ns3 {
         mobModel->SetPosition(position);
     }
 
+    Ptr<NetDevice> MosaicNodeManager::InstallBackboneDevice(Ptr<Node> node) {
+        NetDeviceContainer devices;
+        if (m_backboneDevices.GetN() == 0) {
+            // the first device creates the backbone channel
+            devices = m_csmaHelper.Install(node);
+        } else {
+            Ptr<CsmaChannel> ch = DynamicCast<CsmaChannel>(m_backboneDevices.Get(0)->GetChannel());
+            devices = m_csmaHelper.Install(node, ch);
+        }
+        m_backboneNodes.Add (node);
+        m_backboneDevices.Add (devices);
+        return devices.Get(0);
+    }
+
     void MosaicNodeManager::CreateWiredNode(uint32_t mosaicNodeId) {
-        if (m_mosaic2nsdrei.find(mosaicNodeId) != m_mosaic2nsdrei.end()){
+        if (IsMapped(mosaicNodeId)) {
             NS_LOG_ERROR("Cannot create node with id=" << mosaicNodeId << " multiple times.");
             exit(1);
         }
@@ -336,20 +439,18 @@ namespace ns3 {
         /* create node */
         Ptr<Node> node = CreateObject<Node>();
         NS_LOG_INFO("Create wired node " << mosaicNodeId << "->" << node->GetId());
-        m_mosaic2nsdrei[mosaicNodeId] = node->GetId();
-        m_nsdrei2mosaic[node->GetId()] = mosaicNodeId;
-        m_isWiredNode[node->GetId()] = true;
-        m_backboneNodes.Add (node);
+        MapNodeId(mosaicNodeId, node->GetId());
+        NodeRecord &record = GetNodeRecord(node->GetId());
+        record.Set(NodeRecord::WIRED);
+        record.node = node;
 
         /* install internet stack */
         m_internetHelper.Install (node);
         Ptr<Ipv4> ipv4proto = node->GetObject<Ipv4>();
 
         /* install csma device */
-        Ptr<CsmaChannel> ch = DynamicCast<CsmaChannel>(m_backboneDevices.Get(0)->GetChannel());
-        Ptr<NetDevice> device = m_csmaHelper.Install(node, ch).Get(0);
-        m_backboneDevices.Add (device);
-        m_backboneAddressHelper.Assign (device);
+        Ptr<NetDevice> device = InstallBackboneDevice(node);
+        m_backboneAddressHelper.Assign (NetDeviceContainer(device));
         int32_t ifIndex = ipv4proto->GetInterfaceForDevice(device); // has to be done after m_backboneAddressHelper
 
         /* install application */
@@ -357,9 +458,10 @@ namespace ns3 {
         app->SetRecvCallback(MakeCallback(&MosaicNodeManager::RecvCellMsg, this));
         node->AddApplication(app);
         app->SetSockets(interface_e::ETH);
+        record.cellApp = app;
     }
 
-    Ptr<Node> MosaicNodeManager::CreateRadioNodeHelper(void) {
+    Ptr<Node> MosaicNodeManager::CreateRadioNodeHelper(RadioNodeProfile profile) {
         /* create node */
         Ptr<Node> node = CreateObject<Node>();
 
@@ -370,170 +472,367 @@ namespace ns3 {
         m_mobilityHelper.SetMobilityModel ("ns3::ConstantVelocityMobilityModel");
         m_mobilityHelper.Install (node);
 
-        /* Install WIFI devices */
-        NetDeviceContainer wifiDevices = m_wifiHelper.Install(m_wifiPhyHelper, m_wifiMacHelper, node);
-        Ipv4InterfaceContainer wifiIpIfaces = m_wifiAddressHelper.Assign(wifiDevices);
+        // Devices are 0:Loopback 1:Wifi 2:LTE, or 0:Loopback 1:Wifi|LTE for single radio nodes
+        NodeRecord &record = GetNodeRecord(node->GetId());
+        record.Set(NodeRecord::RADIO);
+        record.node = node;
 
-        /* Install LTE devices */
-        NetDeviceContainer lteDevices = m_lteHelper->InstallUeDevice (node);
-        m_epcHelper->AssignUeIpv4Address (lteDevices);
+        if (profile != RADIO_PROFILE_CELL_ONLY) {
+            /* Install WIFI devices */
+            NetDeviceContainer wifiDevices = m_wifiHelper.Install(m_wifiPhyHelper, m_wifiMacHelper, node);
+            Ipv4InterfaceContainer wifiIpIfaces = m_wifiAddressHelper.Assign(wifiDevices);
 
-        // set the default gateway for the UE
-        uint32_t ifIndex = 2;
-        Ptr<Ipv4StaticRouting> ueStaticRouting = m_ipv4RoutingHelper.GetStaticRouting (ipv4proto);
-        ueStaticRouting->SetDefaultRoute (m_epcHelper->GetUeDefaultGatewayAddress (), ifIndex); // DefaultGateway is 7.0.0.1
+            /* Install ProxyApp application */
+            Ptr<MosaicProxyApp> wifiApp = CreateObject<MosaicProxyApp>();
+            wifiApp->SetRecvCallback(MakeCallback(&MosaicNodeManager::RecvWifiMsg, this));
+            node->AddApplication(wifiApp);
+            wifiApp->SetSockets(interface_e::WIFI, wifiDevices.Get(0));
 
-        /* Install ProxyApp applications */
-        Ptr<MosaicProxyApp> wifiApp = CreateObject<MosaicProxyApp>();
-        wifiApp->SetRecvCallback(MakeCallback(&MosaicNodeManager::RecvWifiMsg, this));
-        node->AddApplication(wifiApp);
-        wifiApp->SetSockets(interface_e::WIFI);
+            record.wifiApp = wifiApp;
+            record.wifiDevice = DynamicCast<WifiNetDevice> (wifiDevices.Get(0));
+            record.wifiPhy = DynamicCast<YansWifiPhy> (record.wifiDevice->GetPhy());
+        }
 
-        Ptr<MosaicProxyApp> cellApp = CreateObject<MosaicProxyApp>();
-        cellApp->SetRecvCallback(MakeCallback(&MosaicNodeManager::RecvCellMsg, this));
-        node->AddApplication(cellApp);
-        cellApp->SetSockets(interface_e::CELL);
+        if (profile != RADIO_PROFILE_WIFI_ONLY) {
+            SetupLte();
+
+            /* Install LTE devices */
+            NetDeviceContainer lteDevices = m_lteHelper->InstallUeDevice (node);
+            m_epcHelper->AssignUeIpv4Address (lteDevices);
+
+            // set the default gateway for the UE
+            uint32_t ifIndex = ipv4proto->GetInterfaceForDevice(lteDevices.Get(0));
+            Ptr<Ipv4StaticRouting> ueStaticRouting = m_ipv4RoutingHelper.GetStaticRouting (ipv4proto);
+            ueStaticRouting->SetDefaultRoute (m_epcHelper->GetUeDefaultGatewayAddress (), ifIndex); // DefaultGateway is 7.0.0.1
+
+            /* Install ProxyApp application */
+            Ptr<MosaicProxyApp> cellApp = CreateObject<MosaicProxyApp>();
+            cellApp->SetRecvCallback(MakeCallback(&MosaicNodeManager::RecvCellMsg, this));
+            node->AddApplication(cellApp);
+            cellApp->SetSockets(interface_e::CELL, lteDevices.Get(0));
+
+            record.cellApp = cellApp;
+            record.lteDevice = DynamicCast<LteUeNetDevice> (lteDevices.Get(0));
+        }
+
+        record.mobility = node->GetObject<MobilityModel> ();
+        record.velocityModel = DynamicCast<ConstantVelocityMobilityModel> (record.mobility);
 
         return node;
     }
 
-    void MosaicNodeManager::CreateRadioNode(uint32_t mosaicNodeId, Vector position) {
-        if (m_mosaic2nsdrei.find(mosaicNodeId) != m_mosaic2nsdrei.end()){
+    void MosaicNodeManager::CreateRadioNode(uint32_t mosaicNodeId, Vector position, RadioNodeProfile profile) {
+        if (IsMapped(mosaicNodeId)) {
             NS_LOG_ERROR("Cannot create node with id=" << mosaicNodeId << " multiple times.");
             exit(1);
         }
 
-        Ptr<Node> node = CreateRadioNodeHelper();
+        Ptr<Node> node = CreateRadioNodeHelper(profile);
 
         NS_LOG_INFO("Create radio node " << mosaicNodeId << "->" << node->GetId());
-        m_mosaic2nsdrei[mosaicNodeId] = node->GetId();
-        m_nsdrei2mosaic[node->GetId()] = mosaicNodeId;
-        m_isRadioNode[node->GetId()] = true;
+        MapNodeId(mosaicNodeId, node->GetId());
+        SetRadioUsage(m_nodes[node->GetId()], profile);
         m_radioNodes.Add (node);
         
         UpdateNodePosition(mosaicNodeId, position);
     }
 
-    void MosaicNodeManager::ActivateRadioNode(uint32_t mosaicNodeId, Vector position) {
-        if (m_mosaic2nsdrei.find(mosaicNodeId) != m_mosaic2nsdrei.end()){
+    void MosaicNodeManager::ActivateRadioNode(uint32_t mosaicNodeId, Vector position, RadioNodeProfile profile) {
+        if (IsMapped(mosaicNodeId)) {
             NS_LOG_ERROR("Cannot create node with id=" << mosaicNodeId << " multiple times.");
             exit(1);
         }
 
-        Ptr<Node> node;
-        for (uint32_t i = 0; i < m_extraRadioNodes.GetN(); ++i)
-        {
-            node = m_extraRadioNodes.Get(i);
-            if (m_nsdrei2mosaic.find(node->GetId()) == m_nsdrei2mosaic.end()){
-                // the node is not used yet, add it to the lookup tables
-                NS_LOG_INFO("Activate radio node " << mosaicNodeId << "->" << node->GetId());
-                m_mosaic2nsdrei[mosaicNodeId] = node->GetId();
-                m_nsdrei2mosaic[node->GetId()] = mosaicNodeId;
-                m_isRadioNode[node->GetId()] = true;
-                m_radioNodes.Add (node);
-                break;
-            }
-        }
-        
-        if (m_mosaic2nsdrei.find(mosaicNodeId) == m_mosaic2nsdrei.end()){
+        uint32_t nodeId;
+        if (!GetFreeRadioNodes(profile).empty()) {
+            nodeId = GetFreeRadioNodes(profile).back();
+            GetFreeRadioNodes(profile).pop_back();
+        } else if (profile == RADIO_PROFILE_WIFI_ONLY) {
+            // without LTE device the node can be created after simulation start
+            nodeId = CreateRadioNodeHelper(profile)->GetId();
+        } else if (profile == RADIO_PROFILE_CELL_ONLY && !m_freeRadioNodes.empty()) {
+            // use a dual node, its wifi is switched off by SetRadioUsage
+            nodeId = m_freeRadioNodes.back();
+            m_freeRadioNodes.pop_back();
+        } else {
             NS_LOG_ERROR("No available node found. Increase number of extra radio nodes!");
             exit(1);
         }
+        NodeRecord &record = m_nodes[nodeId];
+        if (record.Is(NodeRecord::DEACTIVATED)) {
+            // recycled node of a removed vehicle
+            NS_LOG_INFO("Reactivate radio node " << mosaicNodeId << "->" << nodeId);
+            record.flags = NodeRecord::RADIO;
+        } else {
+            NS_LOG_INFO("Activate radio node " << mosaicNodeId << "->" << nodeId);
+            m_radioNodes.Add (record.node);
+        }
+        MapNodeId(mosaicNodeId, nodeId);
+        SetRadioUsage(record, profile);
 
         UpdateNodePosition(mosaicNodeId, position);
     }
 
+    void MosaicNodeManager::SetRadioUsage(NodeRecord &record, RadioNodeProfile profile) {
+        if (profile != RADIO_PROFILE_CELL_ONLY) {
+            record.Set(NodeRecord::USES_WIFI);
+        }
+        if (profile != RADIO_PROFILE_WIFI_ONLY) {
+            record.Set(NodeRecord::USES_CELL);
+        }
+        if (record.wifiPhy != nullptr) {
+            if (record.Is(NodeRecord::USES_WIFI) && record.wifiPhy->IsStateOff()) {
+                record.wifiPhy->ResumeFromOff();
+            } else if (!record.Is(NodeRecord::USES_WIFI) && !record.wifiPhy->IsStateOff()) {
+                record.wifiPhy->SetOffMode();
+            }
+        }
+    }
+
+    std::vector<uint32_t>& MosaicNodeManager::GetFreeRadioNodes(RadioNodeProfile profile) {
+        switch (profile) {
+            case RADIO_PROFILE_WIFI_ONLY:
+                return m_freeWifiNodes;
+            case RADIO_PROFILE_CELL_ONLY:
+                return m_freeCellNodes;
+            default:
+                return m_freeRadioNodes;
+        }
+    }
+
     void MosaicNodeManager::UpdateNodePosition(uint32_t mosaicNodeId, Vector position) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
             return;
         }
 
         // NS_LOG_INFO("[node=" << nodeId << "] x=" << position.x << " y=" << position.y << " z=" << position.z);
 
-        Ptr<Node> node = NodeList::GetNode(nodeId);
-        Ptr<MobilityModel> mobModel = node->GetObject<MobilityModel> ();
-        mobModel->SetPosition(position);
+        MoveNode(nodeId, position, nullptr);
+    }
+
+    void MosaicNodeManager::UpdateNodePositionAndVelocity(uint32_t mosaicNodeId, Vector position, Vector velocity) {
+        uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
+        if (!IsActive(nodeId)) {
+            return;
+        }
+        MoveNode(nodeId, position, &velocity);
+    }
+
+    void MosaicNodeManager::ApplyPositionBatch(std::shared_ptr<const ClientServerChannelSpace::PositionBatch> batch) {
+        const bool hasVelocities = !batch->velocities.empty();
+        for (size_t i = 0; i < batch->ids.size(); i++) {
+            uint32_t nodeId = GetNs3NodeId(batch->ids[i]);
+            if (!IsActive(nodeId)) {
+                continue;
+            }
+            const ClientServerChannelSpace::PositionBatch::Position &position = batch->positions[i];
+            if (hasVelocities && !std::isnan(batch->velocities[i].x)) {
+                const ClientServerChannelSpace::PositionBatch::Position &v = batch->velocities[i];
+                Vector velocity(v.x, v.y, v.z);
+                MoveNode(nodeId, Vector(position.x, position.y, position.z), &velocity);
+            } else {
+                MoveNode(nodeId, Vector(position.x, position.y, position.z), nullptr);
+            }
+        }
+    }
+
+    void MosaicNodeManager::FilterPositionBatch(ClientServerChannelSpace::PositionBatch &batch) {
+        if (m_positionEpsilon <= 0) {
+            return;
+        }
+        const bool hasVelocities = !batch.velocities.empty();
+        size_t kept = 0;
+        for (size_t i = 0; i < batch.ids.size(); i++) {
+            const ClientServerChannelSpace::PositionBatch::Position &p = batch.positions[i];
+            const Vector position(p.x, p.y, p.z);
+            const bool hasVelocity = hasVelocities && !std::isnan(batch.velocities[i].x);
+            auto accepted = m_acceptedPositions.find(batch.ids[i]);
+            Vector velocity = accepted != m_acceptedPositions.end() ? accepted->second.velocity : Vector();
+            if (hasVelocity) {
+                velocity = Vector(batch.velocities[i].x, batch.velocities[i].y, batch.velocities[i].z);
+            }
+
+            if (accepted != m_acceptedPositions.end() && batch.time > accepted->second.time) {
+                AcceptedPosition &last = accepted->second;
+                Vector expected = last.position;
+                if (m_deadReckoning) {
+                    // the node was moved on by dead reckoning since its last update
+                    const double dt = (batch.time - last.time) / 1e9;
+                    expected = Vector(expected.x + last.velocity.x * dt, expected.y + last.velocity.y * dt, expected.z + last.velocity.z * dt);
+                }
+                const bool sameVelocity = !m_deadReckoning || !hasVelocity || CalculateDistance(velocity, last.velocity) < m_positionEpsilon;
+                if (sameVelocity && CalculateDistance(position, expected) < m_positionEpsilon) {
+                    m_countSkippedPositionUpdates++;
+                    continue;
+                }
+                if (!hasVelocity) {
+                    // the same velocity MoveNode derives from the last applied position
+                    const double dt = (batch.time - last.time) / 1e9;
+                    velocity = Vector((position.x - last.position.x) / dt, (position.y - last.position.y) / dt, (position.z - last.position.z) / dt);
+                }
+            }
+            m_acceptedPositions[batch.ids[i]] = AcceptedPosition { position, velocity, batch.time };
+
+            batch.ids[kept] = batch.ids[i];
+            batch.positions[kept] = batch.positions[i];
+            if (hasVelocities) {
+                batch.velocities[kept] = batch.velocities[i];
+            }
+            kept++;
+        }
+        batch.ids.resize(kept);
+        batch.positions.resize(kept);
+        if (hasVelocities) {
+            batch.velocities.resize(kept);
+        }
+    }
+
+    void MosaicNodeManager::ForgetAcceptedPosition(uint32_t mosaicNodeId) {
+        m_acceptedPositions.erase(mosaicNodeId);
+    }
+
+    void MosaicNodeManager::MoveNode(uint32_t nodeId, const Vector &position, const Vector *velocity) {
+        NodeRecord &state = m_nodes[nodeId];
+        if (state.mobility == nullptr) {
+            NS_LOG_ERROR("Node " << nodeId << " has no mobility model, cannot set its position");
+            return;
+        }
+        const Time now = Simulator::Now();
+        state.mobility->SetPosition(position);
+        if (m_deadReckoning && state.velocityModel != nullptr) {
+            if (velocity != nullptr) {
+                state.velocityModel->SetVelocity(*velocity);
+            } else if (state.hasLastUpdate && now > state.lastUpdate) {
+                const double dt = (now - state.lastUpdate).GetSeconds();
+                state.velocityModel->SetVelocity(Vector((position.x - state.lastPosition.x) / dt,
+                                                        (position.y - state.lastPosition.y) / dt,
+                                                        (position.z - state.lastPosition.z) / dt));
+            }
+        }
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+        // after the velocity, which bounds the drift until the channel refreshes its grid
+        if (state.wifiPhy != nullptr) {
+            m_wifiChannel->UpdatePosition(state.wifiPhy, position);
+        }
+#endif
+        state.lastPosition = position;
+        state.lastUpdate = now;
+        state.hasLastUpdate = true;
     }
 
     void MosaicNodeManager::RemoveNode(uint32_t mosaicNodeId) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
             return;
         }
-        
-        Ptr<Node> node = NodeList::GetNode(nodeId);
+        NodeRecord &record = m_nodes[nodeId];
 
         /* deactivate Wifi */
-        if (m_isRadioNode[nodeId]) {
-            // Devices are 0:Loopback 1:Wifi 2:LTE
-            Ptr<WifiNetDevice> netDev = DynamicCast<WifiNetDevice> (node->GetDevice(1));
-            if (netDev == nullptr) {
-                NS_LOG_ERROR("Node " << nodeId << " has no WifiNetDevice");
-                return;
-            }
-            netDev->GetPhy()->SetOffMode();
+        if (record.wifiPhy != nullptr && !record.wifiPhy->IsStateOff()) {
+            record.wifiPhy->SetOffMode();
         }
-        
+
         /* deactivate Apps */
-        int numApps = m_isRadioNode[nodeId] ? 2 : 1;
-        for (uint32_t i = 0; i < numApps; i++ ) {
-            Ptr<MosaicProxyApp> app = DynamicCast<MosaicProxyApp> (node->GetApplication(0));
-            if (!app) {
-                NS_LOG_ERROR("No app with index=" << i << " found on node " << nodeId << " !");
-                exit(1);
-            }
-            app->Disable();
+        if (record.wifiApp) {
+            record.wifiApp->Disable();
+        }
+        if (record.cellApp) {
+            record.cellApp->Disable();
+        }
+
+        /* stop dead reckoning */
+        if (record.velocityModel != nullptr) {
+            record.velocityModel->SetVelocity(Vector(0, 0, 0));
         }
 
-        m_isDeactivated[nodeId] = true;
+        record.Set(NodeRecord::DEACTIVATED);
+
+        /*
+         * A UE cannot be detached from the EPC in ns-3, so radio nodes which configured
+         * their cell radio stay deactivated. All other radio nodes return to the pool.
+         */
+        if (record.Is(NodeRecord::RADIO) && !record.Is(NodeRecord::CELL_CONFIGURED)) {
+            ReleaseRadioNode(mosaicNodeId, nodeId);
+        }
+    }
+
+    void MosaicNodeManager::ReleaseRadioNode(uint32_t mosaicNodeId, uint32_t nodeId) {
+        NodeRecord &record = m_nodes[nodeId];
+
+        /* remove the wifi address assigned by ConfigureWifiRadio */
+        if (record.Is(NodeRecord::WIFI_CONFIGURED)) {
+            Ptr<Ipv4> ipv4proto = record.node->GetObject<Ipv4>();
+            int32_t ifIndex = ipv4proto->GetInterfaceForDevice(record.wifiDevice);
+            ipv4proto->RemoveAddress(ifIndex, record.wifiAddress);
+        }
+
+        /* park the node far away from all others */
+        record.mobility->SetPosition(PARKING_POSITION);
+        record.hasLastUpdate = false;
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+        if (record.wifiPhy != nullptr) {
+            m_wifiChannel->RemovePosition(record.wifiPhy);
+        }
+#endif
+
+        NS_LOG_INFO("Release radio node " << mosaicNodeId << "->" << nodeId);
+        m_mosaic2nsdrei[mosaicNodeId] = REMOVED_NODE_ID;
+        record.mosaicNodeId = INVALID_NODE_ID;
+        record.flags = NodeRecord::RADIO | NodeRecord::DEACTIVATED;
+        if (record.wifiDevice == nullptr) {
+            m_freeCellNodes.push_back(nodeId);
+        } else if (record.lteDevice == nullptr) {
+            m_freeWifiNodes.push_back(nodeId);
+        } else {
+            m_freeRadioNodes.push_back(nodeId);
+        }
+        m_countRecycledRadioNodes++;
     }
 
     void MosaicNodeManager::ConfigureWifiRadio(uint32_t mosaicNodeId, double transmitPower, Ipv4Address ip) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
+            return;
+        }
+        NodeRecord &record = m_nodes[nodeId];
+        if (record.Is(NodeRecord::RADIO) && !record.Is(NodeRecord::USES_WIFI)) {
+            NS_LOG_ERROR("Node " << nodeId << " is a cell-only node. Ignoring wifi configuration.");
             return;
         }
-        if (m_isWifiRadioConfigured[nodeId]) {
+        if (record.Is(NodeRecord::WIFI_CONFIGURED)) {
             NS_LOG_ERROR("Cannot configure WIFI interface multiple times. Ignoring.");
             return;
         }
-        m_isWifiRadioConfigured[nodeId] = true;
+        record.Set(NodeRecord::WIFI_CONFIGURED);
 
-        NS_ASSERT_MSG(m_isRadioNode[nodeId], "Cannot have a wifi interface on a wired node.");
+        NS_ASSERT_MSG(record.Is(NodeRecord::RADIO), "Cannot have a wifi interface on a wired node.");
 
         NS_LOG_INFO("[node=" << nodeId << "] txPow=" << transmitPower << " ip=" << ip);
         
-        Ptr<Node> node = NodeList::GetNode(nodeId);
-        Ptr<MosaicProxyApp> wifiApp = DynamicCast<MosaicProxyApp> (node->GetApplication(0));
-        if (!wifiApp) {
+        Ptr<Node> node = record.node;
+        if (!record.wifiApp) {
             NS_LOG_ERROR("No wifi app found on node " << nodeId << " !");
             exit(1);
         }
-        wifiApp->Enable();
+        record.wifiApp->Enable();
         if (transmitPower > -1) {
-            Ptr<WifiNetDevice> netDev = DynamicCast<WifiNetDevice> (node->GetDevice(1));
-            if (netDev == nullptr) {
-                NS_LOG_ERROR("Inconsistency: no matching NetDevice found on node while configuring");
-                return;
-            }                        
-            Ptr<YansWifiPhy> phy = DynamicCast<YansWifiPhy> (netDev->GetPhy());
-            NS_LOG_INFO("[node=" << nodeId << "] Adjust settings on dev="<< netDev << " phy=" << phy);
-            if (phy != 0) {
+            NS_LOG_INFO("[node=" << nodeId << "] Adjust settings on dev="<< record.wifiDevice << " phy=" << record.wifiPhy);
+            if (record.wifiPhy != 0) {
                 double txDBm = 10 * log10(transmitPower);
-                phy->SetTxPowerStart(txDBm);
-                phy->SetTxPowerEnd(txDBm);
+                record.wifiPhy->SetTxPowerStart(txDBm);
+                record.wifiPhy->SetTxPowerEnd(txDBm);
             }
         }
 
-        // Devices are 0:Loopback 1:Wifi 2:LTE
-        Ptr<NetDevice> device = node->GetDevice(1);
+        Ptr<NetDevice> device = record.wifiDevice;
         Ptr<Ipv4> ipv4proto = node->GetObject<Ipv4>();
         int32_t ifIndex = ipv4proto->GetInterfaceForDevice(device);
 
         // Additionally assign an extra IPv4 Address (without ipv4 helper)
         Ipv4InterfaceAddress ipv4Addr = Ipv4InterfaceAddress(ip, "255.0.0.0");
         ipv4proto->AddAddress(ifIndex, ipv4Addr);
+        record.wifiAddress = ip;
 
         // logging
         std::stringstream ss;
@@ -549,18 +848,23 @@ namespace ns3 {
 
     void MosaicNodeManager::ConfigureCellRadio(uint32_t mosaicNodeId, Ipv4Address ip) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
             return;
         }
-        if (m_isCellRadioConfigured[nodeId]) {
+        NodeRecord &record = m_nodes[nodeId];
+        if (record.Is(NodeRecord::RADIO) && !record.Is(NodeRecord::USES_CELL)) {
+            NS_LOG_ERROR("Node " << nodeId << " is a Wifi-only node. Ignoring cell configuration.");
+            return;
+        }
+        if (record.Is(NodeRecord::CELL_CONFIGURED)) {
             NS_LOG_ERROR("Cannot configure CELL interface multiple times. Ignoring.");
             // When applying this multiple times (with different IPs) then currently the routing will break...
             return;
         }
-        m_isCellRadioConfigured[nodeId] = true;
+        record.Set(NodeRecord::CELL_CONFIGURED);
 
         NS_LOG_INFO("[node=" << nodeId << "] ip=" << ip);
-        Ptr<Node> node = NodeList::GetNode(nodeId);
+        Ptr<Node> node = record.node;
 
         /* check for valid IP, required to match routing configuration */
         bool partOf10 = ip.CombineMask("255.0.0.0").Get() == Ipv4Address("10.0.0.0").Get();
@@ -568,21 +872,19 @@ namespace ns3 {
         bool partOf106 = ip.CombineMask("255.255.0.0").Get() == Ipv4Address("10.6.0.0").Get();
         NS_ASSERT_MSG(partOf10, "The ip for all nodes must be part of 10.0.0.0/8 network.");
 
-        if (m_isRadioNode[nodeId]) {
+        if (record.Is(NodeRecord::RADIO)) {
 
             NS_ASSERT_MSG(!partOf105, "The ip for radio nodes must not be part of 10.5.0.0/16 network.");
             NS_ASSERT_MSG(!partOf106, "The ip for radio nodes must not be part of 10.6.0.0/16 network.");
 
             /* activate application */
-            Ptr<MosaicProxyApp> cellApp = DynamicCast<MosaicProxyApp> (node->GetApplication(1));
-            if (!cellApp) {
+            if (!record.cellApp) {
                 NS_LOG_ERROR("No cell app found on node " << nodeId << " !");
                 exit(1);
             }
-            cellApp->Enable();
+            record.cellApp->Enable();
 
-            // Devices are 0:Loopback 1:Wifi 2:LTE
-            Ptr<NetDevice> device = node->GetDevice(2);
+            Ptr<NetDevice> device = record.lteDevice;
             Ptr<Ipv4> ipv4proto = node->GetObject<Ipv4>();
             uint32_t ifIndex = device->GetIfIndex ();
 
@@ -597,17 +899,16 @@ namespace ns3 {
             // this has to be done _after_ IP address assignment, otherwise the route EPC -> UE is broken
             m_lteHelper->AttachToClosestEnb (device, m_enbDevices);
 
-        } else if (m_isWiredNode[nodeId]) {
+        } else if (record.Is(NodeRecord::WIRED)) {
 
             NS_ASSERT_MSG(partOf105 || partOf106, "The ip for wired nodes must be part of 10.5.0.0/16 or 10.6.0.0/16 network.");
 
             /* activate application */
-            Ptr<MosaicProxyApp> csmaApp = DynamicCast<MosaicProxyApp> (node->GetApplication(0));
-            if (!csmaApp) {
+            if (!record.cellApp) {
                 NS_LOG_ERROR("No csma app found on node " << nodeId << " !");
                 exit(1);
             }
-            csmaApp->Enable();
+            record.cellApp->Enable();
 
             // Devices are 0:Loopback 1:Csma
             Ptr<NetDevice> device = node->GetDevice(1);
@@ -634,18 +935,18 @@ namespace ns3 {
 
     void MosaicNodeManager::SendWifiMsg(uint32_t mosaicNodeId, Ipv4Address dstAddr, ClientServerChannelSpace::RadioChannel channel, uint32_t msgID, uint32_t payLength) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
             return;
         }
+        const NodeRecord &record = m_nodes[nodeId];
         if (channel != ClientServerChannelSpace::RadioChannel::PROTO_CCH) {
             NS_LOG_ERROR("Ns3 only supports one pre-configured wifi channel. Expect value CCH.");
             exit(1);
         }
         NS_LOG_DEBUG("[node=" << nodeId << "] dst=" << dstAddr << " msgID=" << msgID << " len=" << payLength);
 
-        NS_ASSERT_MSG(m_isRadioNode[nodeId], "Cannot use Wifi communication on wired nodes.");
-        Ptr<Node> node = NodeList::GetNode(nodeId);
-        Ptr<MosaicProxyApp> app = DynamicCast<MosaicProxyApp> (node->GetApplication(0));
+        NS_ASSERT_MSG(record.Is(NodeRecord::RADIO), "Cannot use Wifi communication on wired nodes.");
+        MosaicProxyApp *app = PeekPointer(record.wifiApp);
         if (app == nullptr) {
             NS_LOG_ERROR("Node " << nodeId << " was not initialized properly, MosaicProxyApp is missing");
             return;
@@ -655,19 +956,14 @@ namespace ns3 {
 
     void MosaicNodeManager::SendCellMsg(uint32_t mosaicNodeId, Ipv4Address dstAddr, uint32_t msgID, uint32_t payLength) {
         uint32_t nodeId = GetNs3NodeId(mosaicNodeId);
-        if (m_isDeactivated[nodeId]) {
+        if (!IsActive(nodeId)) {
             return;
         }
+        const NodeRecord &record = m_nodes[nodeId];
         NS_LOG_DEBUG("[node=" << nodeId << "] dst=" << dstAddr << " msgID=" << msgID << " len=" << payLength);
 
-
-        Ptr<Node> node = NodeList::GetNode(nodeId);
-        Ptr<MosaicProxyApp> app;
-        if (m_isRadioNode[nodeId]) {
-            app = DynamicCast<MosaicProxyApp> (node->GetApplication(1));
-        } else if (m_isWiredNode[nodeId]) {
-            app = DynamicCast<MosaicProxyApp> (node->GetApplication(0));
-        }
+        // the LTE app on radio nodes, the CSMA app on wired nodes
+        MosaicProxyApp *app = PeekPointer(record.cellApp);
         if (app == nullptr) {
             NS_LOG_ERROR("Node " << nodeId << " was not initialized properly, MosaicProxyApp is missing");
             return;
@@ -676,7 +972,11 @@ namespace ns3 {
     }
 
     void MosaicNodeManager::RecvWifiMsg(unsigned long long recvTime, uint32_t ns3NodeId, int msgID) {
-        if (m_isDeactivated[ns3NodeId]) {
+        if (ns3NodeId < m_nodes.size() && m_nodes[ns3NodeId].Is(NodeRecord::DEACTIVATED)) {
+            return;
+        }
+        m_countReceivedMessages++;
+        if (m_serverPtr == nullptr) {
             return;
         }
         uint32_t nodeId = GetMosaicNodeId(ns3NodeId);
@@ -686,7 +986,11 @@ namespace ns3 {
 
 
     void MosaicNodeManager::RecvCellMsg(unsigned long long recvTime, uint32_t ns3NodeId, int msgID) {
-        if (m_isDeactivated[ns3NodeId]) {
+        if (ns3NodeId < m_nodes.size() && m_nodes[ns3NodeId].Is(NodeRecord::DEACTIVATED)) {
+            return;
+        }
+        m_countReceivedMessages++;
+        if (m_serverPtr == nullptr) {
             return;
         }
         uint32_t nodeId = GetMosaicNodeId(ns3NodeId);
@@ -23,6 +23,7 @@
 #ifndef MOSAIC_NODE_MANAGER_H
 #define MOSAIC_NODE_MANAGER_H
 
+#include <memory>
 #include <unordered_map>
 
 #include "ns3/node-container.h"
@@ -43,13 +44,20 @@
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/mobility-helper.h"
+#include "ns3/constant-velocity-mobility-model.h"
 
 #include "client-server-channel.h"
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+#include "mosaic-wifi-channel.h"
+#endif
 
 namespace ns3 {
 
     //Forward declaration to prevent circular dependency
     class MosaicNs3Bridge;
+    class MosaicProxyApp;
+    class WifiNetDevice;
+    class LteUeNetDevice;
 
     /**
      * @class MosaicNodeManager
@@ -59,10 +67,19 @@ namespace ns3 {
      */
     class MosaicNodeManager : public Object {
     public:
+        /**
+         * @brief Devices installed on radio nodes
+         */
+        enum RadioNodeProfile {
+            RADIO_PROFILE_DUAL,         // Wifi and LTE, nodes added after simulation start are taken from the extra radio nodes
+            RADIO_PROFILE_WIFI_ONLY,    // Wifi only, nodes are created on demand at any simulation time
+            RADIO_PROFILE_CELL_ONLY     // LTE only, like dual nodes they are taken from the extra radio nodes after simulation start
+        };
+
         static TypeId GetTypeId(void);
 
         MosaicNodeManager();
-        virtual ~MosaicNodeManager() = default;
+        virtual ~MosaicNodeManager();
 
         void Configure(MosaicNs3Bridge* serverPtr);
 
@@ -99,16 +116,23 @@ namespace ns3 {
          *
          * @param mosaicNodeId id of the node
          * @param position the new node position as a Vector
+         * @param profile the radios of the node
          */
-        void CreateRadioNode(uint32_t mosaicNodeId, Vector position);
+        void CreateRadioNode(uint32_t mosaicNodeId, Vector position, RadioNodeProfile profile);
 
         /**
-         * @brief activate a radio node (after simulation started)
+         * @brief activate a radio node (after simulation started), Wifi-only nodes are created if no removed node can be reused
          *
          * @param mosaicNodeId id of the node
          * @param position the new node position as a Vector
+         * @param profile the radios of the node
          */
-        void ActivateRadioNode(uint32_t mosaicNodeId, Vector position);
+        void ActivateRadioNode(uint32_t mosaicNodeId, Vector position, RadioNodeProfile profile);
+
+        /**
+         * @brief the radios of nodes which do not request specific ones, set by the RadioNodeProfile attribute
+         */
+        RadioNodeProfile GetRadioNodeProfile(void) const { return m_radioNodeProfile; }
 
         /**
          * @brief update the node position
@@ -117,11 +141,44 @@ namespace ns3 {
          * @param position the new node position as a Vector
          */
         void UpdateNodePosition(uint32_t mosaicNodeId, Vector position);
+
+        /**
+         * @brief update the node position and velocity, the velocity is only applied with DeadReckoning enabled
+         *
+         * @param mosaicNodeId id of the node
+         * @param position the new node position as a Vector
+         * @param velocity the new node velocity in m/s as a Vector
+         */
+        void UpdateNodePositionAndVelocity(uint32_t mosaicNodeId, Vector position, Vector velocity);
+
+        /**
+         * @brief update the positions of all nodes of one UPDATE_NODE(_PACKED) message in one pass
+         *
+         * @param batch MOSAIC node ids and positions, the i-th position belongs to the i-th id
+         */
+        void ApplyPositionBatch(std::shared_ptr<const ClientServerChannelSpace::PositionBatch> batch);
+
+        /**
+         * @brief drop all updates of the batch which move a node by less than PositionEpsilon,
+         * called when the update is received, i.e. before it is scheduled
+         *
+         * @param batch MOSAIC node ids and positions, compacted in place
+         */
+        void FilterPositionBatch(ClientServerChannelSpace::PositionBatch &batch);
+
+        /**
+         * @brief forget the last accepted position of a removed node, called when REMOVE_NODE is received,
+         * i.e. on the same clock as FilterPositionBatch
+         *
+         * @param mosaicNodeId id of the node
+         */
+        void ForgetAcceptedPosition(uint32_t mosaicNodeId);
         
         /**
          * @brief Remove the node as good as possible
          * It is not allowed to delete a node during the simulation.
-         * The node will be deactivated as good as possible.
+         * The node will be deactivated as good as possible. Radio nodes without
+         * a configured cell radio are reset and reused by ActivateRadioNode.
          *
          * @param mosaicNodeId id of the node
          */
@@ -162,13 +219,81 @@ namespace ns3 {
 
         void RecvCellMsg(unsigned long long recvTime, uint32_t ns3NodeId, int msgID);
 
+        /**
+         * @brief number of messages received by active nodes, also counted without a bridge (Configure(nullptr))
+         */
+        uint64_t GetCountReceivedMessages(void) const { return m_countReceivedMessages; }
+
         // Must be public to be accessible by ns-3 object creation routine
         uint16_t m_numExtraRadioNodes;
+        bool m_deadReckoning;
+        RadioNodeProfile m_radioNodeProfile;
+        bool m_lazyLteSetup;
+        double m_positionEpsilon;
 
     private:
 
+        static constexpr uint32_t INVALID_NODE_ID = UINT32_MAX;
+        static constexpr uint32_t REMOVED_NODE_ID = UINT32_MAX - 1; // MOSAIC node whose Ns3 node went back to the pool
+
+        /**
+         * @brief State of one Ns3 node, m_nodes holds one record per Ns3 node ID
+         */
+        struct NodeRecord {
+            enum Flag : uint8_t {
+                RADIO = 1 << 0,
+                WIRED = 1 << 1,
+                WIFI_CONFIGURED = 1 << 2,
+                CELL_CONFIGURED = 1 << 3,
+                DEACTIVATED = 1 << 4,
+                USES_WIFI = 1 << 5,     // the MOSAIC node may configure the Wifi radio
+                USES_CELL = 1 << 6,     // the MOSAIC node may configure the cell radio
+            };
+            uint32_t mosaicNodeId = INVALID_NODE_ID;
+            uint8_t flags = 0;
+
+            // resolved once when the node is created
+            Ptr<Node> node;
+            Ptr<MosaicProxyApp> wifiApp;                        // null on wired and LTE-only nodes
+            Ptr<MosaicProxyApp> cellApp;                        // LTE app on radio nodes, CSMA app on wired nodes
+            Ptr<WifiNetDevice> wifiDevice;
+            Ptr<YansWifiPhy> wifiPhy;
+            Ptr<LteUeNetDevice> lteDevice;
+            Ptr<MobilityModel> mobility;                        // null on wired nodes
+            Ptr<ConstantVelocityMobilityModel> velocityModel;   // null for nodes with a constant position
+            Ipv4Address wifiAddress;                            // set by ConfigureWifiRadio
+
+            // last position update, see MoveNode
+            Vector lastPosition;
+            Time lastUpdate;
+            bool hasLastUpdate = false;
+
+            bool Is(Flag flag) const { return (flags & flag) != 0; }
+            void Set(Flag flag) { flags |= flag; }
+        };
+
+        /**
+         * @brief the record of a Ns3 node, created if it does not exist yet
+         */
+        NodeRecord& GetNodeRecord(uint32_t nodeId);
+
         /**
-         * @brief translate the MOSAIC node IDs to Ns3 node IDs
+         * @brief add the MOSAIC node ID to the ID translation
+         */
+        void MapNodeId(uint32_t mosaicNodeId, uint32_t nodeId);
+
+        /**
+         * @brief whether a Ns3 node was created for the MOSAIC node ID
+         */
+        bool IsMapped(uint32_t mosaicNodeId) const;
+
+        /**
+         * @brief whether the Ns3 node ID (as returned by GetNs3NodeId) belongs to a node which was not removed
+         */
+        bool IsActive(uint32_t nodeId) const;
+
+        /**
+         * @brief translate the MOSAIC node IDs to Ns3 node IDs, REMOVED_NODE_ID if the node was recycled
          */
         uint32_t GetNs3NodeId(uint32_t mosaicNodeId);
 
@@ -177,10 +302,57 @@ namespace ns3 {
          */
         uint32_t GetMosaicNodeId(uint32_t ns3NodeId);
 
+        /**
+         * @brief log the ID translation, used before exiting on an unknown ID
+         */
+        void LogNodeIds(void);
+
+        /**
+         * @brief Last position update of a MOSAIC node which passed FilterPositionBatch
+         */
+        struct AcceptedPosition {
+            Vector position;
+            Vector velocity;
+            int64_t time;
+        };
+
+        /**
+         * @brief set the position of a node and, with DeadReckoning enabled, its velocity.
+         * Without a given velocity it is derived from the previous update.
+         */
+        void MoveNode(uint32_t nodeId, const Vector &position, const Vector *velocity);
+
+        /**
+         * @brief create the LTE and EPC helpers and connect the PGW to the backbone, only done once
+         */
+        void SetupLte(void);
+
+        /**
+         * @brief install a CSMA device on the node and connect it to the backbone
+         */
+        Ptr<NetDevice> InstallBackboneDevice(Ptr<Node> node);
+
+        /**
+         * @brief reset a removed radio node and return it to the pool of free radio nodes
+         */
+        void ReleaseRadioNode(uint32_t mosaicNodeId, uint32_t nodeId);
+
         /**
          * @brief Create a radio node and return it
+         *
+         * @param profile the devices and apps to install
          */ 
-        Ptr<Node> CreateRadioNodeHelper(void);
+        Ptr<Node> CreateRadioNodeHelper(RadioNodeProfile profile);
+
+        /**
+         * @brief set the radios the MOSAIC node may use and switch the Wifi phy on or off accordingly
+         */
+        void SetRadioUsage(NodeRecord &record, RadioNodeProfile profile);
+
+        /**
+         * @brief the free list of removed (or extra) radio nodes with the devices of the profile
+         */
+        std::vector<uint32_t>& GetFreeRadioNodes(RadioNodeProfile profile);
 
         /**
          * @brief Print important information about device/interface configuration
@@ -192,23 +364,29 @@ namespace ns3 {
          */
         void PrintNodeConfigsDeviceAgnostic(NodeContainer nodes, uint32_t maxNum = 100);
 
-        MosaicNs3Bridge *m_serverPtr;
-        std::map<uint32_t, uint32_t> m_mosaic2nsdrei;
-        std::map<uint32_t, uint32_t> m_nsdrei2mosaic;
-        std::unordered_map<uint32_t, bool> m_isRadioNode;
-        std::unordered_map<uint32_t, bool> m_isWiredNode;
-        std::unordered_map<uint32_t, bool> m_isCellRadioConfigured;
-        std::unordered_map<uint32_t, bool> m_isWifiRadioConfigured;
-        std::unordered_map<uint32_t, bool> m_isDeactivated;
+        MosaicNs3Bridge *m_serverPtr = nullptr;
+        std::vector<NodeRecord> m_nodes;            // indexed by Ns3 node ID
+        std::vector<uint32_t> m_mosaic2nsdrei;      // indexed by MOSAIC node ID, INVALID_NODE_ID if not mapped
+        std::unordered_map<uint32_t, AcceptedPosition> m_acceptedPositions;
+        uint64_t m_countSkippedPositionUpdates = 0;
+        std::vector<uint32_t> m_freeRadioNodes;     // Ns3 node IDs of radio nodes usable by ActivateRadioNode
+        std::vector<uint32_t> m_freeWifiNodes;      // same for removed Wifi-only nodes
+        std::vector<uint32_t> m_freeCellNodes;      // same for removed LTE-only nodes
+        uint64_t m_countRecycledRadioNodes = 0;
+        uint64_t m_countReceivedMessages = 0;
 
         /** Helpers **/
         // Wifi
+#ifdef MOSAIC_WIFI_GRID_CHANNEL
+        Ptr<MosaicWifiChannel> m_wifiChannel;
+#else
         YansWifiChannelHelper m_wifiChannelHelper;
+#endif
         YansWifiPhyHelper m_wifiPhyHelper;
         WifiMacHelper m_wifiMacHelper;
         WifiHelper m_wifiHelper;
         // LTE
-        Ptr<LteHelper> m_lteHelper; // problematic if not stored as pointer
+        Ptr<LteHelper> m_lteHelper; // problematic if not stored as pointer, null until SetupLte
         Ptr<PointToPointEpcHelper> m_epcHelper;
         // Wired
         CsmaHelper m_csmaHelper;
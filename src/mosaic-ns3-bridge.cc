@@ -22,15 +22,55 @@
 
 #include "mosaic-ns3-bridge.h"
 
+#include <cmath>
+
 #include "mosaic-simulator-impl.h"
+#include "allocation-counter.h"
+
+#include "ns3/enum.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
 
 NS_LOG_COMPONENT_DEFINE("MosaicNs3Bridge");
 
 namespace ns3 {
     using namespace ClientServerChannelSpace;
 
-    MosaicNs3Bridge::MosaicNs3Bridge(int port, int cmdPort) {
-        std::cout << "Starting ns3 federate on OutPort=" << port << " CmdPort=" << cmdPort << std::endl;
+    static GlobalValue g_nextEventReporting = GlobalValue("NextEventReporting",
+            "How the time of pending events is reported to MOSAIC: Immediate sends a NEXT_EVENT for every newly scheduled time, "
+            "Coalesced only sends the earliest pending event once per ADVANCE_TIME, just before END. "
+            "Observable is like Coalesced, but only considers events which can lead to a RECV_*_MSG.",
+            EnumValue(MosaicNs3Bridge::NEXT_EVENT_IMMEDIATE),
+            MakeEnumChecker(MosaicNs3Bridge::NEXT_EVENT_IMMEDIATE, "Immediate",
+                            MosaicNs3Bridge::NEXT_EVENT_COALESCED, "Coalesced",
+                            MosaicNs3Bridge::NEXT_EVENT_OBSERVABLE, "Observable"));
+
+    static GlobalValue g_cellDeliveryTimeout = GlobalValue("CellDeliveryTimeout",
+            "With NextEventReporting=Observable: time after which a cell message without reception is considered lost. "
+            "While a cell message is in flight, every pending event is considered observable.",
+            TimeValue(Seconds(1)),
+            MakeTimeChecker());
+
+    static void LogChannelStatistics(const std::string &name, const ChannelStatistics &stats) {
+        NS_LOG_INFO(name << ".recvCalls=" << stats.recvCalls);
+        NS_LOG_INFO(name << ".recvBytes=" << stats.recvBytes
+                << " (" << (stats.recvCalls > 0 ? stats.recvBytes / stats.recvCalls : 0) << " bytes per recv)");
+        NS_LOG_INFO(name << ".framesRead=" << stats.framesRead);
+        if (IsHeapAllocationCountEnabled()) {
+            NS_LOG_INFO(name << ".decodeAllocations=" << stats.decodeAllocations);
+        }
+        NS_LOG_INFO(name << ".framesWritten=" << stats.framesWritten);
+        NS_LOG_INFO(name << ".sendCalls=" << stats.sendCalls);
+        NS_LOG_INFO(name << ".sendBytes=" << stats.sendBytes
+                << " (" << (stats.sendCalls > 0 ? stats.sendBytes / stats.sendCalls : 0) << " bytes per send)");
+    }
+
+    MosaicNs3Bridge::MosaicNs3Bridge(int port, int cmdPort, const std::string &socketPath, const std::string &sharedMemoryName) {
+        if (socketPath.empty()) {
+            std::cout << "Starting ns3 federate on OutPort=" << port << " CmdPort=" << cmdPort << std::endl;
+        } else {
+            std::cout << "Starting ns3 federate on SocketPath=" << socketPath << std::endl;
+        }
 
         m_sim = DynamicCast<MosaicSimulatorImpl> (Simulator::GetImplementation());
         if (nullptr == m_sim) {
@@ -47,6 +87,19 @@ namespace ns3 {
         m_closeConnection = false;
         m_didRunOnStart = false;
         m_preemptiveExecutionEnabled = false;
+
+        EnumValue nextEventReporting;
+        g_nextEventReporting.GetValue(nextEventReporting);
+        m_nextEventReporting = static_cast<NextEventReporting>(nextEventReporting.Get());
+        StringValue nextEventReportingName;
+        g_nextEventReporting.GetValue(nextEventReportingName);
+        NS_LOG_INFO("Run with next event reporting: " << nextEventReportingName.Get());
+        if (m_nextEventReporting == NEXT_EVENT_OBSERVABLE) {
+            TimeValue cellDeliveryTimeout;
+            g_cellDeliveryTimeout.GetValue(cellDeliveryTimeout);
+            m_cellDeliveryTimeout = cellDeliveryTimeout.Get().GetNanoSeconds();
+            m_sim->EnableObservableTracking();
+        }
         
         if (Time::GetResolution () == Time::NS) {
             NS_LOG_INFO("Have time scale NS - use factor 1.");
@@ -62,20 +115,40 @@ namespace ns3 {
             exit(1);
         }
 
+        /* Shared memory segments must exist before MOSAIC receives CMD_INIT, they are only used if requested in the InitMessage */
+        std::unique_ptr<SharedMemoryTransport> federateAmbassadorMemory;
+        std::unique_ptr<SharedMemoryTransport> ambassadorFederateMemory;
+        if (!sharedMemoryName.empty()) {
+            federateAmbassadorMemory.reset(new SharedMemoryTransport(sharedMemoryName));
+            ambassadorFederateMemory.reset(new SharedMemoryTransport(sharedMemoryName + ".cmd"));
+        }
+
         /* Initialize federateAmbassadorChannel (mostly for SENDING) */
         NS_LOG_INFO("Initialize federateAmbassadorChannel");
-        federateAmbassadorChannel.prepareConnection("0.0.0.0", port);
+        if (socketPath.empty()) {
+            federateAmbassadorChannel.prepareConnection("0.0.0.0", port);
+        } else {
+            federateAmbassadorChannel.prepareUnixConnection(socketPath);
+        }
         federateAmbassadorChannel.connect();
         federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_INIT);
+        federateAmbassadorChannel.flush();
 
         /* Initialize ambassadorFederateChannel (mostly for RECEIVING) */
         NS_LOG_INFO("Initialize ambassadorFederateChannel");
-        uint16_t assignedPort = ambassadorFederateChannel.prepareConnection("0.0.0.0", cmdPort);
-        if (assignedPort < 1) {
-            std::cout << "Could not prepare port for Command Channel" << std::endl;
-            exit(1);
+        if (socketPath.empty()) {
+            uint16_t assignedPort = ambassadorFederateChannel.prepareConnection("0.0.0.0", cmdPort);
+            if (assignedPort < 1) {
+                std::cout << "Could not prepare port for Command Channel" << std::endl;
+                exit(1);
+            }
+            federateAmbassadorChannel.writePort(assignedPort);
+        } else {
+            // the port exchange is kept for an identical handshake, port 0 refers to the socket path with suffix ".cmd"
+            ambassadorFederateChannel.prepareUnixConnection(socketPath + ".cmd");
+            federateAmbassadorChannel.writePort(0);
         }
-        federateAmbassadorChannel.writePort(assignedPort);
+        federateAmbassadorChannel.flush();
         ambassadorFederateChannel.connect();
         if (ambassadorFederateChannel.readCommand() == CommandMessage_CommandType_INIT) {
             InitMessage message = ambassadorFederateChannel.readInitMessage();
@@ -83,11 +156,29 @@ namespace ns3 {
                     && message.simulation_end_time() >= 0 
                     && message.simulation_end_time() >= message.simulation_start_time()) {
                 m_preemptiveExecutionEnabled = message.preemptive_execution();
+                m_protocolVersion = message.protocol_version();
+                NS_LOG_INFO("Run with protocol version: " << m_protocolVersion);
+                m_receiveBatchesEnabled = message.receive_batches();
+                NS_LOG_INFO("Run with receive batches enabled: " << +m_receiveBatchesEnabled);
+                federateAmbassadorChannel.setReceiverGroupsEnabled(m_receiveBatchesEnabled && message.receiver_groups());
                 NS_LOG_INFO("Run with preemption enabled: " << +m_preemptiveExecutionEnabled);
+                if (message.shared_memory() && sharedMemoryName.empty()) {
+                    ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SHUT_DOWN);
+                    ambassadorFederateChannel.flush();
+                    NS_LOG_ERROR("Shared memory requested in CMD_INIT, but federate was started without --sharedMemory");
+                    exit(1);
+                }
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
+                if (message.shared_memory()) {
+                    // both sides switch after the SUCCESS of CMD_INIT, the sockets stay open but idle
+                    federateAmbassadorChannel.switchToSharedMemory(std::move(federateAmbassadorMemory));
+                    ambassadorFederateChannel.switchToSharedMemory(std::move(ambassadorFederateMemory));
+                }
             } else {
                 // AbstractNetworkAmbassador.java only checks if (CMD.SUCCESS != ...
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SHUT_DOWN);
+                ambassadorFederateChannel.flush();
                 NS_LOG_ERROR("Did not receive meaningful times in first CMD_INIT");
                 exit(1);
             }
@@ -95,7 +186,7 @@ namespace ns3 {
             NS_LOG_ERROR("Did not receive CMD_INIT as first message");
             exit(1);
         }
-        NS_LOG_INFO("Created new connection on port " << port);
+        NS_LOG_INFO("Created new connection on " << (socketPath.empty() ? "port " + std::to_string(port) : socketPath));
     }
 
     MosaicNs3Bridge::~MosaicNs3Bridge() {
@@ -130,203 +221,158 @@ namespace ns3 {
                 break;
 
             case CommandMessage_CommandType_ADD_NODE:
-            {
-                AddNode message = ambassadorFederateChannel.readAddNode();
-                Time tNext = NanoSeconds(message.time());
-                Time tDelay = tNext - m_sim->Now();
-
-                if (message.type() == AddNode_NodeType_RADIO_NODE) {
-                    NS_LOG_DEBUG("Received ADD_RADIO_NODE: mosNID=" << message.node_id() << " pos(x=" << message.x() << " y=" << message.y() << " z=" << message.z() << ") tNext=" << tNext);
-                    if (!m_didRunOnStart) {
-                        m_nodeManager->CreateRadioNode(message.node_id(), Vector(message.x(), message.y(), message.z()));
-                    } else {
-                        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ActivateRadioNode, m_nodeManager, message.node_id(), Vector(message.x(), message.y(), message.z())));
-                    }
-                } else if (message.type() == AddNode_NodeType_WIRED_NODE) {
-                    NS_LOG_DEBUG("Received ADD_WIRED_NODE: mosNID=" << message.node_id() << " tNext=" << tNext);
-                    if (!m_didRunOnStart) {
-                        m_nodeManager->CreateWiredNode(message.node_id());
-                    } else {
-                        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::CreateWiredNode, m_nodeManager, message.node_id()));
-                    }
-                } else if (message.type() == AddNode_NodeType_NODE_B) {
-                    NS_LOG_DEBUG("Received ADD_NODE_B: pos(x=" << message.x() << " y=" << message.y() << " z=" << message.z() << ") tNext=" << tNext);
-                    if (!m_didRunOnStart) {
-                        m_nodeManager->CreateNodeB(Vector(message.x(), message.y(), message.z()));
-                    } else {
-                        NS_LOG_ERROR("Can only add eNBs before simulation start");
-                        exit(1);
-                    }
-                } else {
-                    NS_LOG_ERROR("Received unhandeled ADD_..._NODE message");
-                    m_closeConnection = true;
-                    return;
+                if (!applyAddNode(ambassadorFederateChannel.readAddNode())) {
+                    // a failed single command ends the federate, only COMMAND_BATCH reports failed entries and continues
+                    exit(1);
                 }
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
+
             case CommandMessage_CommandType_UPDATE_NODE:
-            {
-                UpdateNode message = ambassadorFederateChannel.readUpdateNode();
-                Time tNext = NanoSeconds(message.time());
-                Time tDelay = tNext - m_sim->Now();
-
-                for ( size_t i = 0; i < message.properties_size(); i++ ) { //fill the update messages into our struct
-                    UpdateNode_NodeData node_data = message.properties(i);
-                    m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::UpdateNodePosition, m_nodeManager, node_data.id(), Vector(node_data.x(), node_data.y(), node_data.z())));
-                    NS_LOG_DEBUG("Received UPDATE_NODE(S): mosNID=" << node_data.id() << " pos(x=" << node_data.x() << " y=" << node_data.y() << " z=" << node_data.z() << ") tNext=" << tNext);
+                if (!applyUpdateNode(ambassadorFederateChannel.readUpdateNode())) {
+                    exit(1);
                 }
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
-            case CommandMessage_CommandType_REMOVE_NODE:
-            {
-                RemoveNode message = ambassadorFederateChannel.readRemoveNode();
-                Time tNext = NanoSeconds(message.time());
-                Time tDelay = tNext - m_sim->Now();
-                
-                m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::RemoveNode, m_nodeManager, message.node_id()));
-                NS_LOG_DEBUG("Received REMOVE_NODE: mosNID=" << message.node_id() << " tNext=" << tNext);
 
+            case CommandMessage_CommandType_UPDATE_NODE_PACKED:
+                if (!applyPositionBatch(ambassadorFederateChannel.readUpdateNodePacked())) {
+                    exit(1);
+                }
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
+
+            case CommandMessage_CommandType_REMOVE_NODE:
+                if (!applyRemoveNode(ambassadorFederateChannel.readRemoveNode())) {
+                    exit(1);
+                }
+                ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
+                break;
+
             // advance the next time step and run the simulation read the next time step
             case CommandMessage_CommandType_ADVANCE_TIME:
             {
                 m_currentAdvanceTime = ambassadorFederateChannel.readTimeMessage();
                 Time tNext = NanoSeconds(m_currentAdvanceTime);
+                if (tNext < m_sim->Now()) {
+                    NS_LOG_ERROR("Received ADVANCE_TIME " << m_currentAdvanceTime << " before the current time " << m_sim->Now().GetNanoSeconds());
+                    exit(1);
+                }
 
                 if (tNext == NanoSeconds(0)) {
                     // We need that TrafficControlLayer::DoInitialize() (triggered by Node::Initialize()) 
                     // is called _after_ LteHelper::AddX2Interface()
                     // NS_LOG_DEBUG("Ignoring ADVANCE_TIME " << m_currentAdvanceTime);
                     this->writeNextTime(1); // compensate for the skipped time zero
-                    federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_END);
-                    federateAmbassadorChannel.writeTimeMessage(Simulator::Now().GetNanoSeconds());
+                    writeAdvanceWindowEnd(CommandMessage_CommandType_END);
+                    federateAmbassadorChannel.flush();
                     break;
                 }
 
-                if (tNext > NanoSeconds(0) && !m_didRunOnStart) {
-                    m_nodeManager->OnStart();
-                    m_didRunOnStart = true;
+                runAdvanceWindow();
+                writeAdvanceWindowEnd(isPreempted() ? CommandMessage_CommandType_PREEMPTED : CommandMessage_CommandType_END);
+                // all NEXT_EVENT and RECV_* frames of this window are sent together with the END
+                federateAmbassadorChannel.flush();
+                break;
+            }
+            case CommandMessage_CommandType_ADVANCE_TIME_STEPS:
+            {
+                if (m_protocolVersion < ADVANCE_TIME_STEPS_PROTOCOL_VERSION) {
+                    NS_LOG_ERROR("Received ADVANCE_TIME_STEPS, but protocol version " << m_protocolVersion << " was negotiated");
+                    exit(1);
                 }
-
-                m_countTimeAdvanceGrant++;
-
-                // NS_LOG_DEBUG("Received ADVANCE_TIME " << m_currentAdvanceTime); // LTE schedules events every 1ms
-                //run the simulation while the time of the next event is smaller than the next time step
-                m_didRequestEventInThePast = false;
-                while (!Simulator::IsFinished() && NanoSeconds(m_currentAdvanceTime) >= m_sim->Next())
-                {
-                    if (m_preemptiveExecutionEnabled && m_didRequestEventInThePast) {
-                        break;
+                const AdvanceTimeSteps& message = ambassadorFederateChannel.readAdvanceTimeSteps();
+                if (message.step_times_size() == 0) {
+                    NS_LOG_ERROR("Received ADVANCE_TIME_STEPS without steps");
+                    exit(1);
+                }
+                // the first step has to lie beyond the current time and, unless the last window was preempted, beyond the previous grant
+                const int64_t now = m_sim->Now().GetNanoSeconds();
+                const int64_t lowerBound = isPreempted() ? now : std::max<int64_t>(now, m_currentAdvanceTime);
+                for (int i = 0; i < message.step_times_size(); i++) {
+                    if (message.step_times(i) <= (i == 0 ? lowerBound : message.step_times(i - 1))) {
+                        NS_LOG_ERROR("Step times of ADVANCE_TIME_STEPS must be ascending and later than " << lowerBound << ", got " << message.step_times(i) << " at index " << i);
+                        exit(1);
                     }
-                    m_sim->RunOneEvent();
                 }
-
-                // write the confirmation at the end of the sequence
-                // this acknowledgement is exceptionally on the other channel (federate->ambassador)
-                if (m_preemptiveExecutionEnabled && m_didRequestEventInThePast) {
-                    federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_PREEMPTED);
-                } else {
-                    federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_END);
+                NS_LOG_DEBUG("Received ADVANCE_TIME_STEPS: steps=" << message.step_times_size() << " horizon=" << message.step_times(message.step_times_size() - 1));
+
+                for (int i = 0; i < message.step_times_size(); i++) {
+                    m_currentAdvanceTime = message.step_times(i);
+                    const uint64_t receptionsBefore = m_countReceptions;
+                    runAdvanceWindow();
+
+                    if (isPreempted()) {
+                        writeAdvanceWindowEnd(CommandMessage_CommandType_PREEMPTED);
+                    } else if (i + 1 == message.step_times_size() || m_countReceptions != receptionsBefore) {
+                        // MOSAIC has to process the receptions before it can grant further steps
+                        writeAdvanceWindowEnd(CommandMessage_CommandType_END);
+                    } else {
+                        // nothing happened which MOSAIC has to react to, stream the marker and run the next step
+                        writeAdvanceWindowEnd(CommandMessage_CommandType_STEP_END);
+                        federateAmbassadorChannel.flush();
+                        continue;
+                    }
+                    federateAmbassadorChannel.flush();
+                    break;
                 }
-                federateAmbassadorChannel.writeTimeMessage(Simulator::Now().GetNanoSeconds());
                 break;
             }
             case CommandMessage_CommandType_CONF_WIFI_RADIO:
-            {
-                try {
-                    ConfigureWifiRadio message = ambassadorFederateChannel.readConfigureWifiRadio();
-                    Time tNext = NanoSeconds(message.time());
-                    Time tDelay = tNext - m_sim->Now();
-                    double transmitPower = -1;
-                    Ipv4Address ip;
-
-                    if (message.radio_number() == ConfigureWifiRadio_RadioNumber_SINGLE_RADIO) {
-                        transmitPower = message.primary_radio_configuration().transmission_power();
-                        ip.Set(message.primary_radio_configuration().ip_address());
-                    } else {
-                        NS_LOG_ERROR("Currently only SINGLE_RADIO is supported");
-                        exit(1);
-                    }
-
-                    m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ConfigureWifiRadio, m_nodeManager, message.node_id(), transmitPower, ip));
-                    NS_LOG_DEBUG("Received CONF_WIFI_RADIO: mosNID=" << message.node_id() << " tNext=" << tNext);
-
-                } catch (int e) {
-                    NS_LOG_ERROR("Error while reading configuration message");
-                    m_closeConnection = true;
+                if (!applyConfigureWifiRadio(ambassadorFederateChannel.readConfigureWifiRadio())) {
+                    exit(1);
                 }
-                
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
+
             case CommandMessage_CommandType_SEND_WIFI_MSG:
-            {
-                try {
-                    SendWifiMessage message = ambassadorFederateChannel.readSendWifiMessage();
-                    Ipv4Address ip(message.topological_address().ip_address());
-
-                    Time tNext = NanoSeconds(message.time());
-                    // ns3 does not like to send packets at time zero, use 1ns instead
-                    if (tNext == NanoSeconds(0)) {
-                        tNext = NanoSeconds(1);
-                    }
-                    Time tDelay = tNext - m_sim->Now();
-                    m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::SendWifiMsg, m_nodeManager, message.node_id(), ip, message.channel_id(), message.message_id(), message.length()));
-                    NS_LOG_DEBUG("Received SEND_WIFI_MSG: mosNID=" << message.node_id() << " id=" << message.message_id() << " sendTime=" << message.time() << " length=" << message.length());
-                } catch (int e) {
-                    NS_LOG_ERROR("Error while sending message");
+                if (!applySendWifiMessage(ambassadorFederateChannel.readSendWifiMessage())) {
+                    exit(1);
                 }
-
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
-            case CommandMessage_CommandType_CONF_CELL_RADIO:
-            {
-                try {
-                    ConfigureCellRadio message = ambassadorFederateChannel.readConfigureCellRadio();
-                    Time tNext = NanoSeconds(message.time());
-                    Time tDelay = tNext - m_sim->Now();
-                    Ipv4Address ip;
-                    ip.Set(message.ip_address());
-
-                    NS_LOG_DEBUG("Received CONF_CELL_RADIO: mosNID=" << message.node_id() << " tNext=" << tNext);
-                    if (!m_didRunOnStart) {
-                        m_nodeManager->ConfigureCellRadio(message.node_id(), ip);
-                    } else {
-                        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ConfigureCellRadio, m_nodeManager, message.node_id(), ip));
-                    }
 
-                } catch (int e) {
-                    NS_LOG_ERROR("Error while reading configuration message");
-                    m_closeConnection = true;
+            case CommandMessage_CommandType_CONF_CELL_RADIO:
+                if (!applyConfigureCellRadio(ambassadorFederateChannel.readConfigureCellRadio())) {
+                    exit(1);
                 }
-                
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
                 break;
-            }
+
             case CommandMessage_CommandType_SEND_CELL_MSG:
+                if (!applySendCellMessage(ambassadorFederateChannel.readSendCellMessage())) {
+                    exit(1);
+                }
+                ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.flush();
+                break;
+
+            case CommandMessage_CommandType_COMMAND_BATCH:
             {
-                try {
-                    SendCellMessage message = ambassadorFederateChannel.readSendCellMessage();
-                    Ipv4Address ip(message.topological_address().ip_address());
-
-                    Time tNext = NanoSeconds(message.time());
-                    // ns3 does not like to send packets at time zero, use 1ns instead
-                    if (tNext == NanoSeconds(0)) {
-                        tNext = NanoSeconds(1);
+                if (m_protocolVersion < COMMAND_BATCH_PROTOCOL_VERSION) {
+                    NS_LOG_ERROR("Received COMMAND_BATCH, but protocol version " << m_protocolVersion << " was negotiated");
+                    exit(1);
+                }
+                const CommandBatch& batch = ambassadorFederateChannel.readCommandBatch();
+                // entries are applied in order, a failed entry does not stop the following ones
+                m_failedBatchIndices.clear();
+                for (int i = 0; i < batch.entries_size(); i++) {
+                    if (!applyBatchEntry(batch.entries(i))) {
+                        m_failedBatchIndices.push_back(i);
                     }
-                    Time tDelay = tNext - m_sim->Now();
-                    m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::SendCellMsg, m_nodeManager, message.node_id(), ip, message.message_id(), message.length()));
-                    NS_LOG_DEBUG("Received SEND_CELL_MSG: mosNID=" << message.node_id() << " id=" << message.message_id() << " sendTime=" << message.time() << " length=" << message.length());
-                } catch (int e) {
-                    NS_LOG_ERROR("Error while sending message");
                 }
-
+                NS_LOG_DEBUG("Received COMMAND_BATCH: entries=" << batch.entries_size() << " failed=" << m_failedBatchIndices.size());
+                // one cumulative acknowledgement for the whole batch
                 ambassadorFederateChannel.writeCommand(CommandMessage_CommandType_SUCCESS);
+                ambassadorFederateChannel.writeCommandBatchResult(batch.entries_size() - m_failedBatchIndices.size(), m_failedBatchIndices);
+                ambassadorFederateChannel.flush();
                 break;
             }
             case CommandMessage_CommandType_SHUT_DOWN:
@@ -334,6 +380,12 @@ namespace ns3 {
                 m_nodeManager->OnShutdown();
                 NS_LOG_INFO("m_countTimeAdvanceGrant=" << m_countTimeAdvanceGrant);
                 NS_LOG_INFO("m_countNextEventRequest=" << m_countNextEventRequest);
+                NS_LOG_INFO("m_countEvents=" << m_countEvents << " in " << std::chrono::duration<double>(m_eventWallTime).count() << " s ("
+                        << (m_eventWallTime.count() > 0 ? m_countEvents / std::chrono::duration<double>(m_eventWallTime).count() : 0) << " events/s)");
+                NS_LOG_INFO("m_countNextEventFrames=" << m_countNextEventFrames);
+                NS_LOG_INFO("m_countNextEventSuppressed=" << m_countNextEventSuppressed);
+                LogChannelStatistics("ambassadorFederateChannel", ambassadorFederateChannel.getStatistics());
+                LogChannelStatistics("federateAmbassadorChannel", federateAmbassadorChannel.getStatistics());
                 NS_LOG_INFO("Disable log...");
                 LogComponentDisableAll(LOG_LEVEL_ALL);
                 m_closeConnection = true;
@@ -347,13 +399,283 @@ namespace ns3 {
         }
     }
 
+    void MosaicNs3Bridge::runAdvanceWindow() {
+        if (!m_didRunOnStart) {
+            m_nodeManager->OnStart();
+            m_didRunOnStart = true;
+        }
+
+        m_countTimeAdvanceGrant++;
+
+        // NS_LOG_DEBUG("Received ADVANCE_TIME " << m_currentAdvanceTime); // LTE schedules events every 1ms
+        //run the simulation while the time of the next event is smaller than the next time step
+        m_didRequestEventInThePast = false;
+        std::function<bool()> stopPredicate;
+        if (m_preemptiveExecutionEnabled) {
+            stopPredicate = [this]() { return m_didRequestEventInThePast; };
+        }
+        const auto wallStart = std::chrono::steady_clock::now();
+        m_countEvents += m_sim->RunUntil(NanoSeconds(m_currentAdvanceTime).GetTimeStep(), stopPredicate);
+        m_eventWallTime += std::chrono::steady_clock::now() - wallStart;
+    }
+
+    bool MosaicNs3Bridge::isPreempted() const {
+        return m_preemptiveExecutionEnabled && m_didRequestEventInThePast;
+    }
+
+    void MosaicNs3Bridge::writeAdvanceWindowEnd(CommandMessage_CommandType command) {
+        writePendingNextEvent();
+        if (m_receiveBatchesEnabled) {
+            // all receptions of this window, their exact times are part of the batch
+            federateAmbassadorChannel.writeReceiveBatches();
+        }
+
+        // write the confirmation at the end of the sequence
+        // this acknowledgement is exceptionally on the other channel (federate->ambassador)
+        federateAmbassadorChannel.writeCommand(command);
+        federateAmbassadorChannel.writeTimeMessage(Simulator::Now().GetNanoSeconds());
+    }
+
+    bool MosaicNs3Bridge::applyBatchEntry(const CommandBatch_Entry &entry) {
+        switch (entry.command_case()) {
+            case CommandBatch_Entry::kAddNode:
+                return applyAddNode(entry.add_node());
+            case CommandBatch_Entry::kUpdateNode:
+                return applyUpdateNode(entry.update_node());
+            case CommandBatch_Entry::kRemoveNode:
+                return applyRemoveNode(entry.remove_node());
+            case CommandBatch_Entry::kConfigureWifiRadio:
+                return applyConfigureWifiRadio(entry.configure_wifi_radio());
+            case CommandBatch_Entry::kSendWifiMessage:
+                return applySendWifiMessage(entry.send_wifi_message());
+            case CommandBatch_Entry::kConfigureCellRadio:
+                return applyConfigureCellRadio(entry.configure_cell_radio());
+            case CommandBatch_Entry::kSendCellMessage:
+                return applySendCellMessage(entry.send_cell_message());
+            default:
+                NS_LOG_ERROR("Received empty or unknown COMMAND_BATCH entry");
+                return false;
+        }
+    }
+
+    bool MosaicNs3Bridge::applyAddNode(const AddNode &message) {
+        Time tNext = NanoSeconds(message.time());
+        Time tDelay = tNext - m_sim->Now();
+
+        if (message.type() == AddNode_NodeType_RADIO_NODE) {
+            NS_LOG_DEBUG("Received ADD_RADIO_NODE: mosNID=" << message.node_id() << " pos(x=" << message.x() << " y=" << message.y() << " z=" << message.z() << ") tNext=" << tNext);
+            MosaicNodeManager::RadioNodeProfile profile = m_nodeManager->GetRadioNodeProfile();
+            if (message.has_radio_capability()) {
+                switch (message.radio_capability()) {
+                    case AddNode_RadioCapability_RADIO_WIFI_ONLY:
+                        profile = MosaicNodeManager::RADIO_PROFILE_WIFI_ONLY;
+                        break;
+                    case AddNode_RadioCapability_RADIO_CELL_ONLY:
+                        profile = MosaicNodeManager::RADIO_PROFILE_CELL_ONLY;
+                        break;
+                    default:
+                        profile = MosaicNodeManager::RADIO_PROFILE_DUAL;
+                        break;
+                }
+            }
+            if (!m_didRunOnStart) {
+                m_nodeManager->CreateRadioNode(message.node_id(), Vector(message.x(), message.y(), message.z()), profile);
+            } else {
+                m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ActivateRadioNode, m_nodeManager, message.node_id(), Vector(message.x(), message.y(), message.z()), profile));
+            }
+        } else if (message.type() == AddNode_NodeType_WIRED_NODE) {
+            NS_LOG_DEBUG("Received ADD_WIRED_NODE: mosNID=" << message.node_id() << " tNext=" << tNext);
+            if (!m_didRunOnStart) {
+                m_nodeManager->CreateWiredNode(message.node_id());
+            } else {
+                m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::CreateWiredNode, m_nodeManager, message.node_id()));
+            }
+        } else if (message.type() == AddNode_NodeType_NODE_B) {
+            NS_LOG_DEBUG("Received ADD_NODE_B: pos(x=" << message.x() << " y=" << message.y() << " z=" << message.z() << ") tNext=" << tNext);
+            if (!m_didRunOnStart) {
+                m_nodeManager->CreateNodeB(Vector(message.x(), message.y(), message.z()));
+            } else {
+                NS_LOG_ERROR("Can only add eNBs before simulation start");
+                return false;
+            }
+        } else {
+            NS_LOG_ERROR("Received unhandeled ADD_..._NODE message");
+            return false;
+        }
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applyUpdateNode(const UpdateNode &message) {
+        Time tNext = NanoSeconds(message.time());
+        Time tDelay = tNext - m_sim->Now();
+
+        auto batch = std::make_shared<PositionBatch>();
+        batch->time = message.time();
+        batch->ids.reserve(message.properties_size());
+        batch->positions.reserve(message.properties_size());
+        for ( size_t i = 0; i < message.properties_size(); i++ ) { //fill the update messages into our struct
+            const UpdateNode_NodeData& node_data = message.properties(i);
+            batch->ids.push_back(node_data.id());
+            batch->positions.push_back(PositionBatch::Position { node_data.x(), node_data.y(), node_data.z() });
+            if (node_data.has_vx() && node_data.has_vy()) {
+                // earlier nodes of this message without velocity keep deriving it
+                batch->velocities.resize(i, PositionBatch::Position { NAN, NAN, NAN });
+                batch->velocities.push_back(PositionBatch::Position { node_data.vx(), node_data.vy(), node_data.vz() });
+            }
+            NS_LOG_DEBUG("Received UPDATE_NODE(S): mosNID=" << node_data.id() << " pos(x=" << node_data.x() << " y=" << node_data.y() << " z=" << node_data.z() << ") tNext=" << tNext);
+        }
+        if (!batch->velocities.empty()) {
+            batch->velocities.resize(batch->ids.size(), PositionBatch::Position { NAN, NAN, NAN });
+        }
+        m_nodeManager->FilterPositionBatch(*batch);
+        if (batch->ids.empty()) {
+            return true;
+        }
+        // one event for the whole message instead of one per node
+        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ApplyPositionBatch, m_nodeManager, std::shared_ptr<const PositionBatch>(batch)));
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applyPositionBatch(const PositionBatch &batch) {
+        Time tNext = NanoSeconds(batch.time);
+        Time tDelay = tNext - m_sim->Now();
+
+        // the channel reuses its batch for the next message, the event gets its own copy
+        auto filtered = std::make_shared<PositionBatch>(batch);
+        m_nodeManager->FilterPositionBatch(*filtered);
+        NS_LOG_DEBUG("Received UPDATE_NODE_PACKED: nodes=" << batch.ids.size() << " moved=" << filtered->ids.size() << " tNext=" << tNext);
+        if (filtered->ids.empty()) {
+            return true;
+        }
+        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ApplyPositionBatch, m_nodeManager, std::shared_ptr<const PositionBatch>(filtered)));
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applyRemoveNode(const RemoveNode &message) {
+        Time tNext = NanoSeconds(message.time());
+        Time tDelay = tNext - m_sim->Now();
+
+        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::RemoveNode, m_nodeManager, message.node_id()));
+        // the position filter runs at receive time, a later ADD_NODE with the same id must not be compared to the old position
+        m_nodeManager->ForgetAcceptedPosition(message.node_id());
+        NS_LOG_DEBUG("Received REMOVE_NODE: mosNID=" << message.node_id() << " tNext=" << tNext);
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applyConfigureWifiRadio(const ConfigureWifiRadio &message) {
+        Time tNext = NanoSeconds(message.time());
+        Time tDelay = tNext - m_sim->Now();
+        double transmitPower = -1;
+        Ipv4Address ip;
+
+        if (message.radio_number() == ConfigureWifiRadio_RadioNumber_SINGLE_RADIO) {
+            transmitPower = message.primary_radio_configuration().transmission_power();
+            ip.Set(message.primary_radio_configuration().ip_address());
+        } else {
+            NS_LOG_ERROR("Currently only SINGLE_RADIO is supported");
+            return false;
+        }
+
+        m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ConfigureWifiRadio, m_nodeManager, message.node_id(), transmitPower, ip));
+        NS_LOG_DEBUG("Received CONF_WIFI_RADIO: mosNID=" << message.node_id() << " tNext=" << tNext);
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applySendWifiMessage(const SendWifiMessage &message) {
+        if (!message.has_topological_address()) {
+            NS_LOG_ERROR("Only topological addresses are supported for SEND_WIFI_MSG");
+            return false;
+        }
+        Ipv4Address ip(message.topological_address().ip_address());
+
+        Time tNext = NanoSeconds(message.time());
+        // ns3 does not like to send packets at time zero, use 1ns instead
+        if (tNext == NanoSeconds(0)) {
+            tNext = NanoSeconds(1);
+        }
+        Time tDelay = tNext - m_sim->Now();
+        m_sim->ScheduleObservable(tDelay, MakeEvent(&MosaicNodeManager::SendWifiMsg, m_nodeManager, message.node_id(), ip, message.channel_id(), message.message_id(), message.length()));
+        NS_LOG_DEBUG("Received SEND_WIFI_MSG: mosNID=" << message.node_id() << " id=" << message.message_id() << " sendTime=" << message.time() << " length=" << message.length());
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applyConfigureCellRadio(const ConfigureCellRadio &message) {
+        Time tNext = NanoSeconds(message.time());
+        Time tDelay = tNext - m_sim->Now();
+        Ipv4Address ip;
+        ip.Set(message.ip_address());
+
+        NS_LOG_DEBUG("Received CONF_CELL_RADIO: mosNID=" << message.node_id() << " tNext=" << tNext);
+        if (!m_didRunOnStart) {
+            m_nodeManager->ConfigureCellRadio(message.node_id(), ip);
+        } else {
+            m_sim->Schedule(tDelay, MakeEvent(&MosaicNodeManager::ConfigureCellRadio, m_nodeManager, message.node_id(), ip));
+        }
+        return true;
+    }
+
+    bool MosaicNs3Bridge::applySendCellMessage(const SendCellMessage &message) {
+        if (!message.has_topological_address()) {
+            NS_LOG_ERROR("Only topological addresses are supported for SEND_CELL_MSG");
+            return false;
+        }
+        Ipv4Address ip(message.topological_address().ip_address());
+
+        Time tNext = NanoSeconds(message.time());
+        // ns3 does not like to send packets at time zero, use 1ns instead
+        if (tNext == NanoSeconds(0)) {
+            tNext = NanoSeconds(1);
+        }
+        Time tDelay = tNext - m_sim->Now();
+        m_sim->ScheduleObservable(tDelay, MakeEvent(&MosaicNodeManager::SendCellMsg, m_nodeManager, message.node_id(), ip, message.message_id(), message.length()));
+        if (m_nextEventReporting == NEXT_EVENT_OBSERVABLE) {
+            // queued LTE packets are sent by periodic subframe events, which are not observable
+            m_pendingCellMessages[message.message_id()] = tNext.GetNanoSeconds() + m_cellDeliveryTimeout;
+        }
+        NS_LOG_DEBUG("Received SEND_CELL_MSG: mosNID=" << message.node_id() << " id=" << message.message_id() << " sendTime=" << message.time() << " length=" << message.length());
+        return true;
+    }
+
     void MosaicNs3Bridge::writeNextTime(unsigned long long nextTime) {
         if (m_preemptiveExecutionEnabled) {
             return;
         }
-        nextTime *= m_timeFactor; // convert to nanoseconds
+        if (m_nextEventReporting != NEXT_EVENT_IMMEDIATE) {
+            // reported by writePendingNextEvent() at the end of the window, if relevant
+            m_countNextEventSuppressed++;
+            return;
+        }
+        reportNextTime(nextTime * m_timeFactor); // convert to nanoseconds
+    }
+
+    void MosaicNs3Bridge::writePendingNextEvent() {
+        if (m_preemptiveExecutionEnabled || m_nextEventReporting == NEXT_EVENT_IMMEDIATE || m_sim->IsFinished()) {
+            return;
+        }
+        if (m_nextEventReporting == NEXT_EVENT_OBSERVABLE) {
+            for (auto it = m_pendingCellMessages.begin(); it != m_pendingCellMessages.end();) {
+                it = (it->second <= m_currentAdvanceTime) ? m_pendingCellMessages.erase(it) : std::next(it);
+            }
+            if (m_pendingCellMessages.empty()) {
+                // without cell messages in flight, only the taint of the sending events can lead to a reception
+                const Time nextObservable = m_sim->NextObservable();
+                if (nextObservable == m_sim->GetMaximumSimulationTime()) {
+                    return; // nothing can be received before MOSAIC sends something
+                }
+                reportNextTime(std::max<uint64_t>(nextObservable.GetTimeStep() * m_timeFactor, m_currentAdvanceTime + 1));
+                return;
+            }
+        }
+        // all events up to the grant have been processed, so the earliest pending event is the only one MOSAIC
+        // needs to know to choose the next grant; later events are reported once they become the earliest.
+        // Events at the grant itself only remain after the skipped time zero, they are requested right after it.
+        const uint64_t nextTime = m_sim->Next().GetTimeStep() * m_timeFactor;
+        reportNextTime(std::max(nextTime, m_currentAdvanceTime + 1));
+    }
 
+    void MosaicNs3Bridge::reportNextTime(uint64_t nextTime) {
         if (m_reportedTimes.find (nextTime) != m_reportedTimes.end()) {
+            m_countNextEventSuppressed++;
             return;
         }
         m_reportedTimes.insert(nextTime);
@@ -369,29 +691,41 @@ namespace ns3 {
             NS_LOG_DEBUG("nextEvent " << nextTime);
         }
         m_countNextEventRequest++;
+        m_countNextEventFrames++;
         federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_NEXT_EVENT);
         federateAmbassadorChannel.writeTimeMessage(nextTime);
     }
 
     void MosaicNs3Bridge::writeReceiveWifiMessage(unsigned long long recvTime, int nodeID, int msgID) {
         NS_LOG_DEBUG("Received a message! " << recvTime << ":" << m_currentAdvanceTime );
+        m_countReceptions++;
         if (recvTime < m_currentAdvanceTime) {
             NS_LOG_DEBUG("Received a message [smaller than grant]");
             m_didRequestEventInThePast = true;
         } 
         m_countNextEventRequest++;
+        if (m_receiveBatchesEnabled) {
+            federateAmbassadorChannel.queueReceiveWifiMessage(recvTime, nodeID, msgID, RadioChannel::PROTO_CCH);
+            return;
+        }
+        // FIXME: RSSI is hardcoded
         federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_RECV_WIFI_MSG);
         federateAmbassadorChannel.writeReceiveWifiMessage(recvTime, nodeID, msgID, RadioChannel::PROTO_CCH, 0);
-        // FIXME: RSSI is hardcoded
     }
 
     void MosaicNs3Bridge::writeReceiveCellMessage(unsigned long long recvTime, int nodeID, int msgID) {
         NS_LOG_DEBUG("Received a message! " << recvTime << ":" << m_currentAdvanceTime );
+        m_countReceptions++;
         if (recvTime < m_currentAdvanceTime) {
             NS_LOG_DEBUG("Received a message [smaller than grant]");
             m_didRequestEventInThePast = true;
         } 
         m_countNextEventRequest++;
+        m_pendingCellMessages.erase(msgID);
+        if (m_receiveBatchesEnabled) {
+            federateAmbassadorChannel.queueReceiveCellMessage(recvTime, nodeID, msgID);
+            return;
+        }
         federateAmbassadorChannel.writeCommand(CommandMessage_CommandType_RECV_CELL_MSG);
         federateAmbassadorChannel.writeReceiveCellMessage(recvTime, nodeID, msgID);
     }
@@ -27,6 +27,7 @@
 #include "mosaic-node-manager.h"
 
 #include <atomic>
+#include <chrono>
 
 namespace ns3 {
 
@@ -38,15 +39,28 @@ namespace ns3 {
      */
     class MosaicNs3Bridge {
     public:
+        /**
+         * @brief Modes for reporting pending events to MOSAIC, selected by the global value "NextEventReporting"
+         */
+        enum NextEventReporting {
+            NEXT_EVENT_IMMEDIATE,   // NEXT_EVENT for each newly scheduled event time
+            NEXT_EVENT_COALESCED,   // NEXT_EVENT for the earliest pending event, once per ADVANCE_TIME before END
+            NEXT_EVENT_OBSERVABLE   // like coalesced, for the earliest event which can lead to a RECV_*_MSG
+        };
+
         MosaicNs3Bridge() = delete;
 
         /**
          * @brief Constructor: initialize the MosaicNs3Bridge, listen on port and wait for CMD_INIT
          *
-         * @param port    port for sending channel
-         * @param cmdPort port of command channel, for receiving the commands from MOSAIC
+         * @param port       port for sending channel
+         * @param cmdPort    port of command channel, for receiving the commands from MOSAIC
+         * @param socketPath if not empty, use unix domain sockets instead of TCP: the sending channel listens
+         *                   on this path, the command channel on this path with suffix ".cmd"
+         * @param sharedMemoryName if not empty, offer shared memory segments with this name (sending channel)
+         *                   and this name with suffix ".cmd" (command channel), used after INIT if MOSAIC requests them
          */
-        MosaicNs3Bridge(int port, int cmdPort);  
+        MosaicNs3Bridge(int port, int cmdPort, const std::string &socketPath = "", const std::string &sharedMemoryName = "");
 
         /**
          * @brief Destructor
@@ -93,6 +107,52 @@ namespace ns3 {
          */
         void dispatchCommand();
 
+        /**
+         * @brief run all events up to m_currentAdvanceTime, or until the execution is preempted
+         */
+        void runAdvanceWindow();
+
+        /**
+         * @return true, if preemptive execution is enabled and an event in the past was requested in the current window
+         */
+        bool isPreempted() const;
+
+        /**
+         * @brief write pending next event and receptions, followed by the given command (END, PREEMPTED, or STEP_END) and the current time
+         */
+        void writeAdvanceWindowEnd(ClientServerChannelSpace::CommandMessage_CommandType command);
+
+        /**
+         * @brief write the time of the earliest pending event beyond the current grant, if not reported yet
+         * Used with NEXT_EVENT_COALESCED and NEXT_EVENT_OBSERVABLE, called just before END.
+         */
+        void writePendingNextEvent();
+
+        /**
+         * @brief write NEXT_EVENT with the given time in nanoseconds, unless it was already reported
+         */
+        void reportNextTime(uint64_t nextTime);
+
+        /**
+         * @brief Applies a single entry of a COMMAND_BATCH
+         *
+         * @return false, if the entry could not be applied
+         */
+        bool applyBatchEntry(const ClientServerChannelSpace::CommandBatch_Entry &entry);
+
+        /*
+         * Apply a single command, either read directly from the channel or taken from a COMMAND_BATCH.
+         * They return false if the command could not be applied.
+         */
+        bool applyAddNode(const ClientServerChannelSpace::AddNode &message);
+        bool applyUpdateNode(const ClientServerChannelSpace::UpdateNode &message);
+        bool applyPositionBatch(const ClientServerChannelSpace::PositionBatch &batch);
+        bool applyRemoveNode(const ClientServerChannelSpace::RemoveNode &message);
+        bool applyConfigureWifiRadio(const ClientServerChannelSpace::ConfigureWifiRadio &message);
+        bool applySendWifiMessage(const ClientServerChannelSpace::SendWifiMessage &message);
+        bool applyConfigureCellRadio(const ClientServerChannelSpace::ConfigureCellRadio &message);
+        bool applySendCellMessage(const ClientServerChannelSpace::SendCellMessage &message);
+
         ClientServerChannelSpace::ClientServerChannel ambassadorFederateChannel, federateAmbassadorChannel;        
         std::atomic_bool m_closeConnection;
         std::atomic_bool m_didRunOnStart;
@@ -103,11 +163,30 @@ namespace ns3 {
         uint64_t m_currentAdvanceTime = 0;
         uint64_t m_countTimeAdvanceGrant = 0;
         uint64_t m_countNextEventRequest = 0;
+        uint64_t m_countReceptions = 0;
+        /** events processed in ADVANCE_TIME windows and the wall clock time spent on them */
+        uint64_t m_countEvents = 0;
+        std::chrono::steady_clock::duration m_eventWallTime = std::chrono::steady_clock::duration::zero();
+        /** NEXT_EVENT frames written, and NEXT_EVENT reports skipped because of coalescing or duplicates */
+        uint64_t m_countNextEventFrames = 0;
+        uint64_t m_countNextEventSuppressed = 0;
+        NextEventReporting m_nextEventReporting = NEXT_EVENT_IMMEDIATE;
+        /** cell messages in flight (message id to deadline in ns) and their timeout, only with NEXT_EVENT_OBSERVABLE */
+        std::unordered_map<int, uint64_t> m_pendingCellMessages;
+        uint64_t m_cellDeliveryTimeout = 0;
         uint64_t m_timeFactor = 1;
         std::set<uint64_t> m_reportedTimes;
         
         bool m_preemptiveExecutionEnabled;
         bool m_didRequestEventInThePast;
+
+        /** if set, receptions are collected during ADVANCE_TIME and sent as RECV_*_MSG_BATCH before END/PREEMPTED */
+        bool m_receiveBatchesEnabled = false;
+
+        /** protocol version announced by MOSAIC in CMD_INIT */
+        int32_t m_protocolVersion = MIN_PROTOCOL_VERSION;
+        /** indices of the entries of the last COMMAND_BATCH which could not be applied */
+        std::vector<uint32_t> m_failedBatchIndices;
     };
 } // namespace ns3
 #endif /* MOSAIC_NS3_BRIDGE_H */
@@ -86,6 +86,15 @@ namespace ns3 {
     }
 
     void MosaicProxyApp::SetSockets(interface_e outDevice) {
+        Ptr<NetDevice> device;
+        if(outDevice > 0) {
+            int outDeviceIndex = InterfaceToInterfaceIndex(outDevice);
+            device = GetNode()->GetDevice(outDeviceIndex);
+        }
+        SetSockets(outDevice, device);
+    }
+
+    void MosaicProxyApp::SetSockets(interface_e outDevice, Ptr<NetDevice> device) {
         NS_LOG_FUNCTION(GetNode()->GetId());
 
         if (m_socket) {
@@ -96,9 +105,8 @@ namespace ns3 {
         m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
         InetSocketAddress local = InetSocketAddress(Ipv4Address::GetAny(), m_port);
         m_socket->Bind(local);
-        if(outDevice > 0) {
-            int outDeviceIndex = InterfaceToInterfaceIndex(outDevice);
-            m_socket->BindToNetDevice (GetNode()->GetDevice(outDeviceIndex));
+        if (device) {
+            m_socket->BindToNetDevice (device);
         }
         m_socket->SetAllowBroadcast(true);
         m_socket->SetRecvCallback(MakeCallback(&MosaicProxyApp::Receive, this));
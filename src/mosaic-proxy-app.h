@@ -48,6 +48,11 @@ namespace ns3 {
         void SetRecvCallback(Callback<void, unsigned long long, uint32_t, int> cb);
 
         void SetSockets(interface_e outDevice);
+
+        /**
+         * @brief like SetSockets(interface_e), binds to the given device instead of the fixed device index of the interface
+         */
+        void SetSockets(interface_e outDevice, Ptr<NetDevice> device);
         
         void TransmitPacket(Ipv4Address dstAddr, uint32_t msgID, uint32_t payLength);
         
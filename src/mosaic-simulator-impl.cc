@@ -22,6 +22,7 @@
 
 #include "mosaic-simulator-impl.h"
 
+#include <algorithm>
 #include <math.h>
 
 #include "ns3/simulator.h"
@@ -30,6 +31,8 @@
 #include "ns3/pointer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
 
 NS_LOG_COMPONENT_DEFINE("MosaicSimulatorImpl");
 
@@ -37,6 +40,12 @@ namespace ns3 {
 
     NS_OBJECT_ENSURE_REGISTERED(MosaicSimulatorImpl);
 
+    static GlobalValue g_eventTraceFile = GlobalValue("EventTraceFile",
+            "If set, the current time and the event time of every scheduled event are written to this file, "
+            "e.g. to compare the event schedulers with the recorded timestamps (bench scheduler --trace=<file>).",
+            StringValue(""),
+            MakeStringChecker());
+
     TypeId MosaicSimulatorImpl::GetTypeId(void) {
         static TypeId tid = TypeId("ns3::MosaicSimulatorImpl").SetParent<SimulatorImpl> ().AddConstructor<MosaicSimulatorImpl> ();
         return tid;
@@ -55,6 +64,20 @@ namespace ns3 {
         m_currentContext = 0xffffffff;
         m_unscheduledEvents = 0;
         m_eventCount = 0;
+        m_mosaicNs3Bridge = nullptr;
+        m_trackObservableEvents = false;
+        m_currentObservable = false;
+        m_scheduleObservable = false;
+
+        StringValue eventTraceFile;
+        g_eventTraceFile.GetValue(eventTraceFile);
+        if (!eventTraceFile.Get().empty()) {
+            m_eventTrace.reset(new std::ofstream(eventTraceFile.Get()));
+            if (!m_eventTrace->good()) {
+                NS_LOG_ERROR("Could not open event trace file " << eventTraceFile.Get());
+                exit(1);
+            }
+        }
     }
 
     void MosaicSimulatorImpl::DoDispose(void) {
@@ -62,6 +85,8 @@ namespace ns3 {
             Scheduler::Event next = m_events->RemoveNext();
             next.impl->Unref();
         }
+        m_observableEvents.clear();
+        m_eventTrace.reset();
         m_events = 0;
         SimulatorImpl::DoDispose();
     }
@@ -105,8 +130,19 @@ namespace ns3 {
         m_currentTs = next.key.m_ts;
         m_currentContext = next.key.m_context;
         m_currentUid = next.key.m_uid;
+        if (m_trackObservableEvents) {
+            // the heap runs in step with the scheduler, earlier entries belong to removed events
+            while (!m_observableEvents.empty() && m_observableEvents.front().key < next.key) {
+                PopObservable();
+            }
+            m_currentObservable = !m_observableEvents.empty() && m_observableEvents.front().key.m_uid == next.key.m_uid;
+            if (m_currentObservable) {
+                PopObservable();
+            }
+        }
         next.impl->Invoke();
         next.impl->Unref();
+        m_currentObservable = false;
     }
 
     bool MosaicSimulatorImpl::IsFinished(void) const {
@@ -138,6 +174,20 @@ namespace ns3 {
         ProcessOneEvent();
     }
 
+    uint64_t MosaicSimulatorImpl::RunUntil(uint64_t ts, const std::function<bool()> &stopPredicate) {
+        const uint64_t eventCountBefore = m_eventCount;
+        while (!m_events->IsEmpty() && !m_stop) {
+            if (m_events->PeekNext().key.m_ts > ts) {
+                break;
+            }
+            if (stopPredicate && stopPredicate()) {
+                break;
+            }
+            ProcessOneEvent();
+        }
+        return m_eventCount - eventCountBefore;
+    }
+
     uint64_t MosaicSimulatorImpl::GetEventCount(void) const {
         return m_eventCount;
     }
@@ -164,11 +214,56 @@ namespace ns3 {
         m_uid++;
         m_unscheduledEvents++;
         m_events->Insert(ev);
-        m_mosaicNs3Bridge->writeNextTime(ev.key.m_ts);
+        if (m_eventTrace) {
+            *m_eventTrace << m_currentTs << ' ' << ev.key.m_ts << '\n';
+        }
+        MarkObservable(ev);
+        if (m_mosaicNs3Bridge != nullptr) {
+            m_mosaicNs3Bridge->writeNextTime(ev.key.m_ts);
+        }
 
         return EventId(event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
     }
 
+    EventId MosaicSimulatorImpl::ScheduleObservable(Time const &time, EventImpl *event) {
+        m_scheduleObservable = true;
+        EventId id = Schedule(time, event);
+        m_scheduleObservable = false;
+        return id;
+    }
+
+    void MosaicSimulatorImpl::EnableObservableTracking(void) {
+        m_trackObservableEvents = true;
+    }
+
+    Time MosaicSimulatorImpl::NextObservable(void) {
+        // cancelled and removed events stay in the heap, they never run and must not hold back the next grant
+        while (!m_observableEvents.empty() && m_observableEvents.front().impl->IsCancelled()) {
+            PopObservable();
+        }
+        if (m_observableEvents.empty()) {
+            return GetMaximumSimulationTime();
+        }
+        return TimeStep(m_observableEvents.front().key.m_ts);
+    }
+
+    bool MosaicSimulatorImpl::IsLaterObservable(const ObservableEvent &a, const ObservableEvent &b) {
+        return a.key > b.key;
+    }
+
+    void MosaicSimulatorImpl::MarkObservable(const Scheduler::Event &ev) {
+        if (!m_trackObservableEvents || (!m_scheduleObservable && !m_currentObservable)) {
+            return;
+        }
+        m_observableEvents.push_back(ObservableEvent{ev.key, Ptr<EventImpl>(ev.impl)});
+        std::push_heap(m_observableEvents.begin(), m_observableEvents.end(), &IsLaterObservable);
+    }
+
+    void MosaicSimulatorImpl::PopObservable(void) {
+        std::pop_heap(m_observableEvents.begin(), m_observableEvents.end(), &IsLaterObservable);
+        m_observableEvents.pop_back();
+    }
+
     void MosaicSimulatorImpl::ScheduleWithContext(uint32_t context, Time const &time, EventImpl *event) {
         NS_LOG_FUNCTION(this << context << time.GetTimeStep() << m_currentTs << event);
 
@@ -180,7 +275,13 @@ namespace ns3 {
         m_uid++;
         m_unscheduledEvents++;
         m_events->Insert(ev);
-        m_mosaicNs3Bridge->writeNextTime(ev.key.m_ts);
+        if (m_eventTrace) {
+            *m_eventTrace << m_currentTs << ' ' << ev.key.m_ts << '\n';
+        }
+        MarkObservable(ev);
+        if (m_mosaicNs3Bridge != nullptr) {
+            m_mosaicNs3Bridge->writeNextTime(ev.key.m_ts);
+        }
     }
 
     EventId MosaicSimulatorImpl::ScheduleNow(EventImpl *event) {
@@ -193,6 +294,10 @@ namespace ns3 {
         m_uid++;
         m_unscheduledEvents++;
         m_events->Insert(ev);
+        if (m_eventTrace) {
+            *m_eventTrace << m_currentTs << ' ' << ev.key.m_ts << '\n';
+        }
+        MarkObservable(ev);
 
         return EventId(event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
     }
@@ -23,7 +23,11 @@
 #ifndef MOSAIC_SIMULATOR_IMPL_H
 #define MOSAIC_SIMULATOR_IMPL_H
 
+#include <fstream>
+#include <functional>
 #include <list>
+#include <memory>
+#include <vector>
 
 #include "ns3/simulator-impl.h"
 #include "ns3/scheduler.h"
@@ -54,12 +58,36 @@ namespace ns3 {
 
         /**
          * @brief Attach the instance of the MOSAIC bridge to the object of this class
+         * Without a bridge, e.g. in the benchmarks, scheduled events are not reported.
          *
          * @param instance the MOSAIC server instance
          */
         void AttachBridge(MosaicNs3Bridge* instance);
         
         virtual EventId Schedule(Time const &time, EventImpl *event);
+
+        /**
+         * @brief Schedule an event whose consequences can be visible to MOSAIC, e.g. the sending of a message.
+         * Every event scheduled while an observable event is executed is observable as well, thus
+         * a reception in MosaicProxyApp::Receive is observable if it is caused by such a sending.
+         * The propagation is not limited in time, e.g. ARP retries or packets waiting in the Wifi MAC queue
+         * stay observable however late they run. Without EnableObservableTracking() this is the same as Schedule().
+         */
+        EventId ScheduleObservable(Time const &time, EventImpl *event);
+
+        /**
+         * @brief Start to track observable events, must be called before the first event is scheduled
+         */
+        void EnableObservableTracking(void);
+
+        /**
+         * @brief get the time of the earliest pending observable event, a lower bound for the next output to MOSAIC
+         *
+         * Cancelled events are dropped, they never run and thus cannot lead to an output.
+         *
+         * @return the time, or GetMaximumSimulationTime() if no observable event is pending
+         */
+        Time NextObservable(void);
         virtual void Destroy();
         virtual bool IsFinished(void) const;
         virtual Time Next(void) const;
@@ -73,6 +101,15 @@ namespace ns3 {
         virtual bool IsExpired(const EventId &ev) const;
         virtual void Run(void);
         virtual void RunOneEvent(void);
+
+        /**
+         * @brief Run all events with a timestamp up to and including ts in one loop
+         *
+         * @param ts the last timestamp to process, in time steps
+         * @param stopPredicate checked before each event, the loop stops if it returns true (may be empty)
+         * @return the number of processed events
+         */
+        uint64_t RunUntil(uint64_t ts, const std::function<bool()> &stopPredicate);
         virtual Time Now(void) const;
         virtual Time GetDelayLeft(const EventId &id) const;
         virtual Time GetMaximumSimulationTime(void) const;
@@ -102,6 +139,33 @@ namespace ns3 {
         int m_unscheduledEvents;
         MosaicNs3Bridge* m_mosaicNs3Bridge;
 
+        struct ObservableEvent {
+            Scheduler::EventKey key;
+            /** keeps removed events alive until the entry is dropped */
+            Ptr<EventImpl> impl;
+        };
+
+        // min-heap of the observable events, in the order of the scheduler, only filled if tracking is enabled.
+        // Entries of removed events are dropped lazily, once a later event runs.
+        bool m_trackObservableEvents;
+        bool m_currentObservable;
+        bool m_scheduleObservable;
+        std::vector<ObservableEvent> m_observableEvents;
+
+        /**
+         * @brief remember the event as observable if it is scheduled by ScheduleObservable, or from an observable event
+         */
+        void MarkObservable(const Scheduler::Event &ev);
+
+        /**
+         * @brief remove the earliest entry of m_observableEvents
+         */
+        void PopObservable(void);
+        static bool IsLaterObservable(const ObservableEvent &a, const ObservableEvent &b);
+
+        // "current time, event time" per scheduled event, only written if EventTraceFile is set
+        std::unique_ptr<std::ofstream> m_eventTrace;
+
     };
 } // namespace ns3
 #endif /* MOSAIC_SIMULATOR_IMPL_H */
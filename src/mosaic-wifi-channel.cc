@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "mosaic-wifi-channel.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ns3/double.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/mobility-model.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/wifi-ppdu.h"
+#include "ns3/net-device.h"
+#include "ns3/node.h"
+
+NS_LOG_COMPONENT_DEFINE("MosaicWifiChannel");
+
+namespace ns3 {
+
+    NS_OBJECT_ENSURE_REGISTERED(MosaicWifiChannel);
+
+    TypeId MosaicWifiChannel::GetTypeId(void) {
+        static TypeId tid = TypeId("ns3::MosaicWifiChannel")
+                .SetParent<YansWifiChannel>()
+                .AddConstructor<MosaicWifiChannel>()
+                .AddAttribute("MaxRange", "Maximum distance in meters at which a transmission is delivered, 0 delivers to all PHYs",
+                DoubleValue(0),
+                MakeDoubleAccessor(&MosaicWifiChannel::m_maxRange),
+                MakeDoubleChecker<double> (0))
+                .AddAttribute("GridMargin", "Distance in meters a node may move before the grid is refreshed from the mobility models, widens the grid cells",
+                DoubleValue(50),
+                MakeDoubleAccessor(&MosaicWifiChannel::m_gridMargin),
+                MakeDoubleChecker<double> (0))
+                ;
+        return tid;
+    }
+
+    MosaicWifiChannel::MosaicWifiChannel()
+      : m_maxRange(0),
+        m_gridMargin(0),
+        m_maxSpeed(0) {
+    }
+
+    void MosaicWifiChannel::Add(Ptr<YansWifiPhy> phy) {
+        YansWifiChannel::Add(phy);
+        m_entries[PeekPointer(phy)] = GridEntry{0, 0, false};
+    }
+
+    int64_t MosaicWifiChannel::MakeCell(int64_t cx, int64_t cy) {
+        return (int64_t) (((uint64_t) cx << 32) | ((uint64_t) cy & 0xffffffffu));
+    }
+
+    int64_t MosaicWifiChannel::GetCell(const Vector &position) const {
+        const double cellSize = m_maxRange + m_gridMargin;
+        return MakeCell((int64_t) std::floor(position.x / cellSize), (int64_t) std::floor(position.y / cellSize));
+    }
+
+    void MosaicWifiChannel::UpdatePosition(Ptr<YansWifiPhy> phy, const Vector &position) {
+        if (!IsCulling()) {
+            return;
+        }
+        auto it = m_entries.find(PeekPointer(phy));
+        if (it == m_entries.end()) {
+            NS_LOG_ERROR("PHY " << phy << " is not attached to this channel");
+            return;
+        }
+        MoveToCell(it->second, phy, GetCell(position));
+        Ptr<MobilityModel> mobility = phy->GetMobility();
+        if (mobility != nullptr) {
+            m_maxSpeed = std::max(m_maxSpeed, mobility->GetVelocity().GetLength());
+        }
+    }
+
+    void MosaicWifiChannel::RemovePosition(Ptr<YansWifiPhy> phy) {
+        auto it = m_entries.find(PeekPointer(phy));
+        if (it == m_entries.end() || !it->second.placed) {
+            return;
+        }
+        TakeOut(it->second);
+    }
+
+    void MosaicWifiChannel::MoveToCell(GridEntry &entry, Ptr<YansWifiPhy> phy, int64_t cell) const {
+        if (entry.placed) {
+            if (entry.cell == cell) {
+                return;
+            }
+            TakeOut(entry);
+        }
+        std::vector<Ptr<YansWifiPhy>> &phys = m_cells[cell];
+        entry.cell = cell;
+        entry.slot = phys.size();
+        entry.placed = true;
+        phys.push_back(phy);
+    }
+
+    void MosaicWifiChannel::TakeOut(GridEntry &entry) const {
+        std::vector<Ptr<YansWifiPhy>> &phys = m_cells[entry.cell];
+        // swap with the last PHY of the cell, the order within a cell does not matter
+        if (entry.slot + 1 != phys.size()) {
+            phys[entry.slot] = phys.back();
+            m_entries[PeekPointer(phys[entry.slot])].slot = entry.slot;
+        }
+        phys.pop_back();
+        entry.placed = false;
+    }
+
+    void MosaicWifiChannel::RefreshGrid(void) const {
+        const Time now = Simulator::Now();
+        if (m_maxSpeed * (now - m_lastRefresh).GetSeconds() <= m_gridMargin) {
+            return;
+        }
+        NS_LOG_FUNCTION(this << now << m_maxSpeed);
+        m_lastRefresh = now;
+        m_maxSpeed = 0;
+        for (auto &it : m_entries) {
+            GridEntry &entry = it.second;
+            if (!entry.placed) {
+                continue;
+            }
+            Ptr<YansWifiPhy> phy = m_cells[entry.cell][entry.slot];
+            Ptr<MobilityModel> mobility = phy->GetMobility();
+            MoveToCell(entry, phy, GetCell(mobility->GetPosition()));
+            m_maxSpeed = std::max(m_maxSpeed, mobility->GetVelocity().GetLength());
+        }
+    }
+
+    void MosaicWifiChannel::Send(Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const {
+        if (!IsCulling()) {
+            YansWifiChannel::Send(sender, ppdu, txPowerDbm);
+            return;
+        }
+        NS_LOG_FUNCTION(this << sender << ppdu << txPowerDbm);
+        RefreshGrid();
+        Ptr<MobilityModel> senderMobility = sender->GetMobility();
+        NS_ASSERT(senderMobility != nullptr);
+        const Vector senderPosition = senderMobility->GetPosition();
+
+        const double cellSize = m_maxRange + m_gridMargin;
+        const int64_t cx = (int64_t) std::floor(senderPosition.x / cellSize);
+        const int64_t cy = (int64_t) std::floor(senderPosition.y / cellSize);
+        for (int64_t dx = -1; dx <= 1; ++dx) {
+            for (int64_t dy = -1; dy <= 1; ++dy) {
+                auto cellIt = m_cells.find(MakeCell(cx + dx, cy + dy));
+                if (cellIt == m_cells.end()) {
+                    continue;
+                }
+                for (const Ptr<YansWifiPhy> &receiver : cellIt->second) {
+                    if (receiver != sender) {
+                        DeliverTo(sender, senderMobility, receiver, ppdu, txPowerDbm);
+                    }
+                }
+            }
+        }
+    }
+
+    void MosaicWifiChannel::DeliverTo(Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility, Ptr<YansWifiPhy> receiver,
+            Ptr<const WifiPpdu> ppdu, double txPowerDbm) const {
+        // as in YansWifiChannel::Send, no inter channel interference nor channel bonding
+        if (receiver->GetChannelNumber() != sender->GetChannelNumber()) {
+            return;
+        }
+        Ptr<MobilityModel> receiverMobility = receiver->GetMobility();
+        if (senderMobility->GetDistanceFrom(receiverMobility) > m_maxRange) {
+            return;
+        }
+        Time delay = m_delay->GetDelay(senderMobility, receiverMobility);
+        double rxPowerDbm = m_loss->CalcRxPower(txPowerDbm, senderMobility, receiverMobility);
+        Ptr<WifiPpdu> copy = ppdu->Copy();
+        Ptr<NetDevice> dstNetDevice = receiver->GetDevice();
+        uint32_t dstNode = dstNetDevice == nullptr ? 0xffffffff : dstNetDevice->GetNode()->GetId();
+        Simulator::ScheduleWithContext(dstNode, delay, &YansWifiChannel::Receive, receiver, copy, rxPowerDbm);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef MOSAIC_WIFI_CHANNEL_H
+#define MOSAIC_WIFI_CHANNEL_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "ns3/nstime.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/yans-wifi-phy.h"
+#include "ns3/vector.h"
+
+namespace ns3 {
+
+    /**
+     * @class MosaicWifiChannel
+     * @brief A YansWifiChannel which only delivers transmissions to PHYs within MaxRange of the sender.
+     * Only built with premake5 --wifi-grid-channel (MOSAIC_WIFI_GRID_CHANNEL), as it requires ns-3 patched
+     * with patches/ns3-yans-wifi-channel.patch, which makes Add and Send of the YansWifiChannel virtual.
+     *
+     * The PHYs are kept in a uniform grid with cells of MaxRange + GridMargin, so a transmission only
+     * visits the 3x3 cells around the sender instead of every PHY of the channel. The grid is updated
+     * by the MosaicNodeManager with each position update. With dead reckoning the nodes move between
+     * updates, so Send re-buckets all PHYs from their mobility models as soon as the fastest PHY could
+     * have moved GridMargin since the last refresh. PHYs without a position are not in the grid and
+     * receive nothing, e.g. unused extra radio nodes.
+     *
+     * With MaxRange 0 (the default) the channel behaves like the YansWifiChannel.
+     */
+    class MosaicWifiChannel : public YansWifiChannel {
+    public:
+        static TypeId GetTypeId(void);
+
+        MosaicWifiChannel();
+        virtual ~MosaicWifiChannel() = default;
+
+        virtual void Add(Ptr<YansWifiPhy> phy);
+        virtual void Send(Ptr<YansWifiPhy> sender, Ptr<const WifiPpdu> ppdu, double txPowerDbm) const;
+
+        /**
+         * @brief Moves the PHY to the grid cell of the given position, to be called after its velocity was set
+         */
+        void UpdatePosition(Ptr<YansWifiPhy> phy, const Vector &position);
+
+        /**
+         * @brief Takes the PHY out of the grid until its next UpdatePosition, it receives nothing meanwhile.
+         */
+        void RemovePosition(Ptr<YansWifiPhy> phy);
+
+        bool IsCulling(void) const {
+            return m_maxRange > 0;
+        }
+
+    private:
+        struct GridEntry {
+            int64_t cell;
+            uint32_t slot;  // index in the PHY vector of the cell
+            bool placed;
+        };
+
+        int64_t GetCell(const Vector &position) const;
+        static int64_t MakeCell(int64_t cx, int64_t cy);
+
+        void MoveToCell(GridEntry &entry, Ptr<YansWifiPhy> phy, int64_t cell) const;
+        void TakeOut(GridEntry &entry) const;
+
+        /**
+         * @brief re-bucket all PHYs from their current positions if one of them could have left its cell's margin
+         */
+        void RefreshGrid(void) const;
+
+        void DeliverTo(Ptr<YansWifiPhy> sender, Ptr<MobilityModel> senderMobility, Ptr<YansWifiPhy> receiver,
+                Ptr<const WifiPpdu> ppdu, double txPowerDbm) const;
+
+        double m_maxRange;
+        double m_gridMargin;
+
+        // the grid caches the mobility positions, it is refreshed from the const Send
+        mutable std::unordered_map<const YansWifiPhy *, GridEntry> m_entries;
+        mutable std::unordered_map<int64_t, std::vector<Ptr<YansWifiPhy>>> m_cells;
+        mutable Time m_lastRefresh;
+        // upper bound of the speed in m/s of all PHYs in the grid since m_lastRefresh
+        mutable double m_maxSpeed;
+    };
+}
+
+#endif /* MOSAIC_WIFI_CHANNEL_H */
@@ -0,0 +1,325 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "shared-memory-transport.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+#include <ns3/log.h>
+
+NS_LOG_COMPONENT_DEFINE("SharedMemoryTransport");
+
+namespace ClientServerChannelSpace {
+
+static_assert ( std::atomic < uint64_t >::is_always_lock_free && std::atomic < uint32_t >::is_always_lock_free,
+                "the rings need address-free atomics to be shared between processes" );
+
+/** bounds of the adaptive spin before a reader or writer goes to sleep */
+constexpr const uint32_t MIN_SPIN = 64;
+constexpr const uint32_t MAX_SPIN = 64 * 1024;
+
+namespace {
+
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile ( "yield" );
+#endif
+}
+
+/**
+ * Sleeps as long as the futex word has the expected value, at most for the given time. The futex is
+ * not process private, as the peer waits and wakes on the same physical page.
+ */
+inline void futexWait(std::atomic < uint32_t >* word, uint32_t expected, const timespec* timeout) {
+    syscall ( SYS_futex, reinterpret_cast < uint32_t* > ( word ), FUTEX_WAIT, expected, timeout, nullptr, 0 );
+}
+
+inline void futexWake(std::atomic < uint32_t >* word) {
+    syscall ( SYS_futex, reinterpret_cast < uint32_t* > ( word ), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0 );
+}
+
+void initRing(SharedMemoryRing& ring) {
+    ring.head.store ( 0 );
+    ring.tail.store ( 0 );
+    ring.writeSequence.store ( 0 );
+    ring.readerWaiting.store ( 0 );
+    ring.readSequence.store ( 0 );
+    ring.writerWaiting.store ( 0 );
+}
+
+} // namespace
+
+SharedMemoryTransport::SharedMemoryTransport(const std::string& name, Role role, uint32_t ringSize) :
+    name(name), role(role), ringSize(ringSize), peerSocket(-1), peerGone(false), spinLimit(MIN_SPIN) {
+    void* address;
+    if ( role == FEDERATE ) {
+        if ( ringSize == 0 || ( ringSize & ( ringSize - 1 ) ) != 0 ) {
+            NS_LOG_ERROR("Ring size of shared memory segment " << name << " must be a power of two, got " << ringSize);
+            exit(1);
+        }
+        shm_unlink ( name.c_str() ); // remove leftovers of a previous run
+        const int fd = shm_open ( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600 );
+        if ( fd < 0 ) {
+            NS_LOG_ERROR("Could not create shared memory segment " << name << ": " << strerror(errno));
+            exit(1);
+        }
+        mappedSize = sizeof ( SharedMemorySegment ) + 2 * static_cast < size_t > ( ringSize );
+        if ( ftruncate ( fd, mappedSize ) != 0 ) {
+            NS_LOG_ERROR("Could not resize shared memory segment " << name << " to " << mappedSize << " bytes: " << strerror(errno));
+            close ( fd );
+            exit(1);
+        }
+        address = mmap ( nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close ( fd ); // the mapping keeps the segment alive
+        if ( address == MAP_FAILED ) {
+            NS_LOG_ERROR("Could not map shared memory segment " << name << ": " << strerror(errno));
+            exit(1);
+        }
+
+        segment = new ( address ) SharedMemorySegment;
+        initRing ( segment->toFederate );
+        initRing ( segment->toAmbassador );
+        segment->closed.store ( 0 );
+        segment->ringSize = ringSize;
+    } else {
+        const int fd = shm_open ( name.c_str(), O_RDWR, 0600 );
+        struct stat status;
+        if ( fd < 0 || fstat ( fd, &status ) != 0 ) {
+            NS_LOG_ERROR("Could not open shared memory segment " << name << ": " << strerror(errno));
+            exit(1);
+        }
+        mappedSize = status.st_size;
+        address = mmap ( nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close ( fd );
+        if ( address == MAP_FAILED ) {
+            NS_LOG_ERROR("Could not map shared memory segment " << name << ": " << strerror(errno));
+            exit(1);
+        }
+        segment = static_cast < SharedMemorySegment* > ( address );
+        if ( mappedSize < sizeof ( SharedMemorySegment ) || segment->magic != SHARED_MEMORY_MAGIC ) {
+            NS_LOG_ERROR("Shared memory segment " << name << " is not initialized");
+            exit(1);
+        }
+        std::atomic_thread_fence ( std::memory_order_acquire );
+        this->ringSize = segment->ringSize;
+        if ( mappedSize < sizeof ( SharedMemorySegment ) + 2 * static_cast < size_t > ( this->ringSize ) ) {
+            NS_LOG_ERROR("Shared memory segment " << name << " has " << mappedSize << " bytes, too small for rings of " << this->ringSize << " bytes");
+            exit(1);
+        }
+    }
+
+    // the ambassador->federate ring comes first in the data area
+    char* toFederateData = static_cast < char* > ( address ) + sizeof ( SharedMemorySegment );
+    char* toAmbassadorData = toFederateData + this->ringSize;
+    if ( role == FEDERATE ) {
+        inbound = &segment->toFederate;
+        outbound = &segment->toAmbassador;
+        inboundData = toFederateData;
+        outboundData = toAmbassadorData;
+        // publish the magic last, the ambassador must not use the segment before
+        std::atomic_thread_fence ( std::memory_order_release );
+        segment->magic = SHARED_MEMORY_MAGIC;
+        NS_LOG_INFO("Created shared memory segment " << name << " with two rings of " << ringSize << " bytes");
+    } else {
+        inbound = &segment->toAmbassador;
+        outbound = &segment->toFederate;
+        inboundData = toAmbassadorData;
+        outboundData = toFederateData;
+        NS_LOG_INFO("Attached to shared memory segment " << name << " with two rings of " << this->ringSize << " bytes");
+    }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport() {
+    segment->closed.store ( 1 );
+    for ( SharedMemoryRing* ring : { &segment->toFederate, &segment->toAmbassador } ) {
+        ring->writeSequence.fetch_add ( 1 );
+        ring->readSequence.fetch_add ( 1 );
+        futexWake ( &ring->writeSequence );
+        futexWake ( &ring->readSequence );
+    }
+    munmap ( segment, mappedSize );
+    if ( role == FEDERATE ) {
+        shm_unlink ( name.c_str() );
+    }
+}
+
+void SharedMemoryTransport::setPeerSocket(int socket) {
+    peerSocket = socket;
+}
+
+size_t SharedMemoryTransport::receive(char* buffer, size_t size) {
+    SharedMemoryRing& ring = *inbound;
+    const uint64_t tail = ring.tail.load ( std::memory_order_relaxed );
+    const uint64_t head = waitForData ( ring, tail );
+    const size_t count = std::min ( static_cast < size_t > ( head - tail ), size );
+    if ( count == 0 ) {
+        return 0; // closed by the peer
+    }
+    const size_t offset = tail & ( ringSize - 1 );
+    const size_t first = std::min ( count, ringSize - offset );
+    memcpy ( buffer, inboundData + offset, first );
+    memcpy ( buffer + first, inboundData, count - first );
+
+    ring.tail.store ( tail + count );
+    ring.readSequence.fetch_add ( 1 );
+    if ( ring.writerWaiting.load() ) {
+        futexWake ( &ring.readSequence );
+    }
+    return count;
+}
+
+bool SharedMemoryTransport::send(const char* buffer, size_t size) {
+    SharedMemoryRing& ring = *outbound;
+    uint64_t head = ring.head.load ( std::memory_order_relaxed );
+    while ( size > 0 ) {
+        const uint64_t tail = waitForSpace ( ring, head );
+        const size_t count = std::min ( size, ringSize - static_cast < size_t > ( head - tail ) );
+        if ( count == 0 ) {
+            return false; // closed by the peer
+        }
+        const size_t offset = head & ( ringSize - 1 );
+        const size_t first = std::min ( count, ringSize - offset );
+        memcpy ( outboundData + offset, buffer, first );
+        memcpy ( outboundData, buffer + first, count - first );
+
+        head += count;
+        ring.head.store ( head );
+        ring.writeSequence.fetch_add ( 1 );
+        if ( ring.readerWaiting.load() ) {
+            futexWake ( &ring.writeSequence );
+        }
+        buffer += count;
+        size -= count;
+    }
+    return true;
+}
+
+const std::string& SharedMemoryTransport::getName() const {
+    return name;
+}
+
+/*
+ * Both wait functions spin for spinLimit iterations first. If the other side answered while spinning,
+ * the limit is doubled, otherwise halved, so that the spin follows the typical answer time of the peer.
+ * Sleeping uses the flag/sequence protocol: the waiter announces itself before re-checking the ring,
+ * the other side bumps the sequence before checking the flag, thus one of them always sees the other.
+ */
+
+uint64_t SharedMemoryTransport::waitForData(SharedMemoryRing& ring, uint64_t tail) {
+    uint64_t head = ring.head.load ( std::memory_order_acquire );
+    if ( head != tail ) {
+        return head;
+    }
+    for ( uint32_t i = 0; i < spinLimit; ++i ) {
+        cpuRelax();
+        head = ring.head.load ( std::memory_order_acquire );
+        if ( head != tail ) {
+            spinLimit = std::min ( spinLimit * 2, MAX_SPIN );
+            return head;
+        }
+    }
+    spinLimit = std::max ( spinLimit / 2, MIN_SPIN );
+    while ( true ) {
+        const uint32_t sequence = ring.writeSequence.load();
+        ring.readerWaiting.store ( 1 );
+        head = ring.head.load();
+        if ( head != tail || isClosed() ) {
+            ring.readerWaiting.store ( 0 );
+            return head;
+        }
+        sleepOn ( ring.writeSequence, sequence );
+        ring.readerWaiting.store ( 0 );
+    }
+}
+
+uint64_t SharedMemoryTransport::waitForSpace(SharedMemoryRing& ring, uint64_t head) {
+    uint64_t tail = ring.tail.load ( std::memory_order_acquire );
+    if ( head - tail < ringSize ) {
+        return tail;
+    }
+    for ( uint32_t i = 0; i < spinLimit; ++i ) {
+        cpuRelax();
+        tail = ring.tail.load ( std::memory_order_acquire );
+        if ( head - tail < ringSize ) {
+            spinLimit = std::min ( spinLimit * 2, MAX_SPIN );
+            return tail;
+        }
+    }
+    spinLimit = std::max ( spinLimit / 2, MIN_SPIN );
+    while ( true ) {
+        const uint32_t sequence = ring.readSequence.load();
+        ring.writerWaiting.store ( 1 );
+        tail = ring.tail.load();
+        if ( head - tail < ringSize ) {
+            ring.writerWaiting.store ( 0 );
+            return tail;
+        }
+        if ( isClosed() ) {
+            ring.writerWaiting.store ( 0 );
+            return head - ringSize; // no space, send() gives up
+        }
+        sleepOn ( ring.readSequence, sequence );
+        ring.writerWaiting.store ( 0 );
+    }
+}
+
+void SharedMemoryTransport::sleepOn(std::atomic < uint32_t >& word, uint32_t expected) {
+    const timespec timeout = { SHARED_MEMORY_PEER_CHECK_MS / 1000, ( SHARED_MEMORY_PEER_CHECK_MS % 1000 ) * 1000000L };
+    futexWait ( &word, expected, &timeout );
+}
+
+bool SharedMemoryTransport::isClosed() {
+    if ( segment->closed.load() || peerGone ) {
+        return true;
+    }
+    if ( peerSocket < 0 ) {
+        return false;
+    }
+    // the peer does not send anything on the socket after the switch, so readable means EOF or an error
+    pollfd descriptor = { peerSocket, POLLIN | POLLRDHUP, 0 };
+    if ( poll ( &descriptor, 1, 0 ) <= 0 ) {
+        return false;
+    }
+    char byte;
+    if ( ( descriptor.revents & ( POLLHUP | POLLRDHUP | POLLERR | POLLNVAL ) ) != 0
+            || recv ( peerSocket, &byte, 1, MSG_PEEK | MSG_DONTWAIT ) == 0 ) {
+        NS_LOG_ERROR("Peer of shared memory segment " << name << " closed its socket " << peerSocket);
+        peerGone = true;
+    }
+    return peerGone;
+}
+
+} // namespace ClientServerChannelSpace
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef SHARED_MEMORY_TRANSPORT_H
+#define SHARED_MEMORY_TRANSPORT_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace ClientServerChannelSpace {
+
+/**
+ * Control block of a single-producer/single-consumer byte ring inside the shared memory segment.
+ * head and tail count all bytes ever written and read, the position in the data area is the count
+ * modulo the ring size. The sequence numbers are used as futex words to wait for the other side.
+ */
+struct SharedMemoryRing {
+	/** bytes written so far, only modified by the producer */
+	alignas(64) std::atomic < uint64_t > head;
+	/** bytes read so far, only modified by the consumer */
+	alignas(64) std::atomic < uint64_t > tail;
+	/** incremented by the producer after each write, the consumer waits on it if the ring is empty */
+	alignas(64) std::atomic < uint32_t > writeSequence;
+	/** set by the consumer while it is waiting on writeSequence */
+	std::atomic < uint32_t > readerWaiting;
+	/** incremented by the consumer after each read, the producer waits on it if the ring is full */
+	alignas(64) std::atomic < uint32_t > readSequence;
+	/** set by the producer while it is waiting on readSequence */
+	std::atomic < uint32_t > writerWaiting;
+};
+
+/**
+ * Layout of the shared memory segment. The control block is followed by the data area of the
+ * ambassador->federate ring and then by the data area of the federate->ambassador ring, each ringSize bytes.
+ */
+struct SharedMemorySegment {
+	/** SHARED_MEMORY_MAGIC once the segment is initialized */
+	uint32_t magic;
+	/** size of each data area in bytes, a power of two */
+	uint32_t ringSize;
+	/** set by either side when it detaches, the other side then sees the end of the stream */
+	std::atomic < uint32_t > closed;
+	SharedMemoryRing toFederate;
+	SharedMemoryRing toAmbassador;
+};
+
+constexpr const uint32_t SHARED_MEMORY_MAGIC = 0x4d4f5331; // "MOS1"
+constexpr const uint32_t SHARED_MEMORY_RING_SIZE = 4 * 1024 * 1024;
+
+/** interval in which a sleeping reader or writer checks whether the peer is still alive */
+constexpr const int SHARED_MEMORY_PEER_CHECK_MS = 100;
+
+/**
+ * Byte stream transport between Ambassador and Federate via two SPSC ring buffers in a POSIX shared
+ * memory segment. It replaces the socket of a ClientServerChannel after the handshake, framing and
+ * commands stay the same. A reader or writer spins for a short, adaptive time before it sleeps on a futex.
+ * While sleeping, it checks every SHARED_MEMORY_PEER_CHECK_MS whether the still open handshake socket
+ * of the peer was closed, e.g. because the peer crashed without marking the segment as closed.
+ */
+class SharedMemoryTransport {
+
+	public:
+		/** the side of the connection, which decides on the direction of the rings */
+		enum Role {
+			/** creates the segment, reads from toFederate and writes to toAmbassador */
+			FEDERATE,
+			/** attaches to the segment of the federate, e.g. a stand-in of the ambassador */
+			AMBASSADOR
+		};
+
+		/**
+		 * @brief Creates and maps the shared memory segment (FEDERATE), an existing segment with the same name is replaced,
+		 * or maps the existing segment created by the federate (AMBASSADOR)
+		 *
+		 * @param name name of the segment for shm_open, e.g. "/mosaic-ns3"
+		 * @param role side of the connection
+		 * @param ringSize size of each ring in bytes, has to be a power of two, taken from the segment for AMBASSADOR
+		 */
+		SharedMemoryTransport(const std::string& name, Role role = FEDERATE, uint32_t ringSize = SHARED_MEMORY_RING_SIZE);
+
+		/**
+		 * @brief Destructor
+		 *
+		 * Marks the segment as closed, wakes the peer, and removes the segment if it was created by this side.
+		 */
+		~SharedMemoryTransport();
+
+		SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+		SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+
+		/**
+		 * @brief Sets the handshake socket of the peer, which is checked for EOF while waiting
+		 *
+		 * @param socket connected socket, the transport does not take ownership
+		 */
+		void setPeerSocket(int socket);
+
+		/**
+		 * @brief Reads the available bytes of the inbound ring, blocks until at least one byte is available
+		 *
+		 * @param buffer buffer to copy the bytes to
+		 * @param size maximum number of bytes to read
+		 * @return number of bytes read, 0 if the peer closed the segment or its socket
+		 */
+		size_t receive(char* buffer, size_t size);
+
+		/**
+		 * @brief Writes all bytes to the outbound ring, blocks while the ring is full
+		 *
+		 * @param buffer bytes to write
+		 * @param size number of bytes to write
+		 * @return false, if the peer closed the segment or its socket
+		 */
+		bool send(const char* buffer, size_t size);
+
+		/**
+		 * @return name of the segment
+		 */
+		const std::string& getName() const;
+
+	private:
+		std::string name;
+		Role role;
+		size_t mappedSize;
+		SharedMemorySegment* segment;
+		SharedMemoryRing* inbound;
+		SharedMemoryRing* outbound;
+		char* inboundData;
+		char* outboundData;
+		uint32_t ringSize;
+
+		/** handshake socket of the peer, -1 if unknown */
+		int peerSocket;
+		/** set once the peer socket was found closed */
+		bool peerGone;
+
+		/** current number of spin iterations before sleeping, adapted to the recent waiting times */
+		uint32_t spinLimit;
+
+		/**
+		 * @brief Waits until the ring holds more than the given number of bytes
+		 *
+		 * @return the current head of the ring
+		 */
+		uint64_t waitForData(SharedMemoryRing& ring, uint64_t tail);
+
+		/**
+		 * @brief Waits until the ring has free space
+		 *
+		 * @return the current tail of the ring
+		 */
+		uint64_t waitForSpace(SharedMemoryRing& ring, uint64_t head);
+
+		/**
+		 * @brief Sleeps on the futex word for at most SHARED_MEMORY_PEER_CHECK_MS, then checks the peer socket
+		 */
+		void sleepOn(std::atomic < uint32_t >& word, uint32_t expected);
+
+		/**
+		 * @return true, if the peer marked the segment as closed or its socket was closed
+		 */
+		bool isClosed();
+};
+
+} // namespace ClientServerChannelSpace
+#endif /* SHARED_MEMORY_TRANSPORT_H */
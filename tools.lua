@@ -22,4 +22,20 @@ function tools.check_bin ( bin )
     return found_bin:gsub("\n","")
 end
 
+-- module to check installed files
+
+function tools.check_contains ( path, text, hint )
+    local file = io.open ( path, 'r' )
+    if ( file == nil ) then
+        print ( "ERROR: " .. path .. " not found! " .. hint )
+        os.exit ( 1 )
+    end
+    local content = file:read "*a"
+    file:close ()
+    if ( string.find ( content, text, 1, true ) == nil ) then
+        print ( "ERROR: " .. path .. " does not contain '" .. text .. "'! " .. hint )
+        os.exit ( 1 )
+    end
+end
+
 return tools
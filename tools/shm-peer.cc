@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2020 Fraunhofer FOKUS and others. All rights reserved.
+ *
+ * Contact: mosaic@fokus.fraunhofer.de
+ *
+ * This class is developed for the MOSAIC-NS-3 coupling.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+/*
+ * Stand-in for the MOSAIC ambassador to exercise the shared memory transport without MOSAIC:
+ * connects to a federate started with --sharedMemory, does the INIT handshake with shared_memory set,
+ * attaches to both segments and runs ADVANCE_TIME/END round trips over the rings, e.g.
+ *
+ *   bin/Release/ns3-federate --port=5011 --cmdPort=5012 --sharedMemory=/mosaic &
+ *   bin/Release/shm-peer --port=5011 --sharedMemory=/mosaic --rounds=10000
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "ns3/command-line.h"
+
+#include "client-server-channel.h"
+#include "shared-memory-transport.h"
+
+using namespace ClientServerChannelSpace;
+
+namespace {
+
+    const int CONNECT_ATTEMPTS = 50;
+
+    /**
+     * Connects to the federate, which might still be starting up.
+     */
+    bool Connect(ClientServerChannel &channel, const std::string &host, uint32_t port, const std::string &socketPath) {
+        for (int attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++) {
+            if (socketPath.empty() ? channel.connectTo(host, port) : channel.connectToUnix(socketPath)) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        return false;
+    }
+
+    /**
+     * Reads the answer to ADVANCE_TIME up to END, skipping NEXT_EVENT reports.
+     */
+    bool ReadEnd(ClientServerChannel &channel, int64_t time) {
+        while (true) {
+            switch (channel.readCommand()) {
+            case CommandMessage_CommandType_NEXT_EVENT:
+                channel.readTimeMessage();
+                break;
+            case CommandMessage_CommandType_END:
+                return channel.readTimeMessage() == time;
+            default:
+                return false;
+            }
+        }
+    }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string host = "127.0.0.1";
+    uint32_t port = 5011;
+    std::string socketPath;
+    std::string sharedMemoryName = "/mosaic-ns3";
+    uint32_t rounds = 10000;
+    int64_t timeStep = 1000000;
+
+    ns3::CommandLine cmd;
+    cmd.Usage("Runs ADVANCE_TIME/END round trips against a federate over its shared memory segments.");
+    cmd.AddValue("host", "host of the federate", host);
+    cmd.AddValue("port", "port of the federate, see --port of ns3-federate", port);
+    cmd.AddValue("socketPath", "unix domain socket of the federate, used instead of host and port if set", socketPath);
+    cmd.AddValue("sharedMemory", "name of the shared memory segments, see --sharedMemory of ns3-federate", sharedMemoryName);
+    cmd.AddValue("rounds", "number of round trips", rounds);
+    cmd.AddValue("timeStep", "simulation time advanced per round trip in ns", timeStep);
+    cmd.Parse(argc, argv);
+
+    ClientServerChannel federateAmbassador;
+    ClientServerChannel ambassadorFederate;
+    if (!Connect(federateAmbassador, host, port, socketPath)) {
+        std::cerr << "Could not connect to the federate" << std::endl;
+        return 1;
+    }
+    if (federateAmbassador.readCommand() != CommandMessage_CommandType_INIT) {
+        std::cerr << "Did not receive CMD_INIT from the federate" << std::endl;
+        return 1;
+    }
+    const uint32_t cmdPort = federateAmbassador.readPort();
+    if (!Connect(ambassadorFederate, host, cmdPort, socketPath.empty() ? "" : socketPath + ".cmd")) {
+        std::cerr << "Could not connect to the command channel of the federate" << std::endl;
+        return 1;
+    }
+
+    InitMessage init;
+    init.set_simulation_start_time(0);
+    init.set_simulation_end_time(timeStep * (rounds + 1));
+    init.set_protocol_version(PROTOCOL_VERSION);
+    init.set_preemptive_execution(false);
+    init.set_shared_memory(true);
+    ambassadorFederate.writeCommand(CommandMessage_CommandType_INIT);
+    ambassadorFederate.writeInitMessage(init);
+    ambassadorFederate.flush();
+    if (ambassadorFederate.readCommand() != CommandMessage_CommandType_SUCCESS) {
+        std::cerr << "Federate did not accept CMD_INIT" << std::endl;
+        return 1;
+    }
+    // the federate created the segments before it accepted the first connection
+    federateAmbassador.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(
+            new SharedMemoryTransport(sharedMemoryName, SharedMemoryTransport::AMBASSADOR)));
+    ambassadorFederate.switchToSharedMemory(std::unique_ptr<SharedMemoryTransport>(
+            new SharedMemoryTransport(sharedMemoryName + ".cmd", SharedMemoryTransport::AMBASSADOR)));
+
+    std::vector<double> samples;
+    samples.reserve(rounds);
+    for (uint32_t i = 1; i <= rounds; i++) {
+        const int64_t time = i * timeStep;
+        const auto start = std::chrono::steady_clock::now();
+        ambassadorFederate.writeCommand(CommandMessage_CommandType_ADVANCE_TIME);
+        ambassadorFederate.writeTimeMessage(time);
+        ambassadorFederate.flush();
+        if (!ReadEnd(federateAmbassador, time)) {
+            std::cerr << "Unexpected answer to ADVANCE_TIME " << time << std::endl;
+            return 1;
+        }
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    ambassadorFederate.writeCommand(CommandMessage_CommandType_SHUT_DOWN);
+    ambassadorFederate.flush();
+
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (double sample : samples) {
+            sum += sample;
+        }
+        std::cout << "shm round trip: n=" << samples.size()
+                  << " mean=" << sum / samples.size() << "us"
+                  << " p50=" << samples[samples.size() / 2] << "us"
+                  << " p99=" << samples[samples.size() * 99 / 100] << "us"
+                  << " max=" << samples.back() << "us" << std::endl;
+    }
+    return 0;
+}